@@ -0,0 +1,171 @@
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+#include "net/NetCommon.hpp"
+#include "net/GameHost.hpp"
+#include "net/LobbyClient.hpp"
+
+// Headless game host: GameHost on a fixed tick plus the lobby announce/heartbeat, no window,
+// tileset or rendering. Nobody plays in slot 0; the run starts at launch so joiners go straight in.
+
+using Clock = std::chrono::steady_clock;
+
+struct GameServerApp
+{
+    NetRuntime rt;
+    GameHost host;
+    LobbyClient lobby;
+    bool announcing = false;
+
+    static GameServerApp* self;
+
+    static void onConnStatus(SteamNetConnectionStatusChangedCallback_t* info)
+    {
+        if (!self) return;
+        if (info->m_info.m_hListenSocket == self->host.listenSocket()) {
+            self->host.onConnStatusChanged(info);
+            return;
+        }
+        if (self->announcing && info->m_hConn == self->lobby.conn()) {
+            self->lobby.onConnStatusChanged(info);
+        }
+    }
+};
+
+GameServerApp* GameServerApp::self = nullptr;
+
+int main(int argc, char** argv)
+{
+    uint16_t port = 27020;
+    uint32_t seed = 0xC0FFEEu;
+    std::string lobbyAddr;
+    std::string name = "Dedicated";
+    GameHostConfig hostCfg;
+    std::chrono::seconds statsInterval{ 60 };
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const std::string s = argv[i];
+            if (s == "--lobby" && i + 1 < argc) lobbyAddr = argv[++i];
+            else if (s == "--name" && i + 1 < argc) name = argv[++i];
+            else if (s == "--seed" && i + 1 < argc) seed = (uint32_t)std::stoul(argv[++i]);
+            else if (s == "--tick-hz" && i + 1 < argc) hostCfg.tickHz = (uint32_t)std::stoul(argv[++i]);
+            else if (s == "--snap-every" && i + 1 < argc) hostCfg.snapEveryTicks = (uint32_t)std::stoul(argv[++i]);
+            else if (s == "--stats-interval" && i + 1 < argc) statsInterval = std::chrono::seconds(std::stoi(argv[++i]));
+            else port = static_cast<uint16_t>(std::stoi(s));
+        }
+    }
+    catch (...) {
+        std::cerr << "Usage: RLO_GameServer [port] [--lobby HOST:PORT] [--name NAME] [--seed N] [--tick-hz N] [--snap-every N] [--stats-interval S]\n";
+        return 2;
+    }
+
+#ifdef _WIN32
+    // Default timer resolution is ~15 ms, coarser than a tick
+    timeBeginPeriod(1);
+#endif
+
+    GameServerApp app;
+    GameServerApp::self = &app;
+
+    // No GNS service thread: we block on the sockets between ticks instead
+    NetRuntimeConfig rtCfg;
+    rtCfg.manualPoll = true;
+    if (!app.rt.init(rtCfg)) {
+        std::cerr << "NetRuntime init failed\n";
+        return 1;
+    }
+    app.rt.setConnStatusRouter(&GameServerApp::onConnStatus);
+
+    if (!app.host.start(app.rt.iface(), port, seed, hostCfg)) {
+        std::cerr << "Failed to start game host on UDP " << port << "\n";
+        app.rt.shutdown();
+        return 3;
+    }
+    app.host.startGame();
+
+    if (!lobbyAddr.empty()) {
+        app.announcing = true;
+        if (!app.lobby.connect(app.rt.iface(), lobbyAddr, LobbyClient::Role::Announcer)) {
+            app.host.stop();
+            app.rt.shutdown();
+            return 5;
+        }
+        app.lobby.setAnnounceInfo(app.host.port(), 3, seed, name);
+    }
+
+    std::cout << "[GameServer] Running on UDP " << app.host.port() << "\n";
+
+    auto lastSim = Clock::now();
+    auto nextHeartbeat = lastSim + std::chrono::seconds(1);
+    auto statsFrom = lastSim;
+    uint32_t statsTicks = 0;
+    Clock::duration maxLate{};
+    std::vector<GameHost::ClientNetStats> netStats;
+
+    for (;;) {
+        // Block on the sockets for whole milliseconds, then sleep the rest, so a tick starts on
+        // time instead of up to a millisecond late (inputs arriving meanwhile are read right away).
+        // The sockets are serviced every iteration, even when the tick is due or late: with manual
+        // polling nothing else reads them, and a server behind on ticks must not stop its IO.
+        const auto tickAt = lastSim + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(app.host.timeToNextTick()));
+        auto now = Clock::now();
+        const auto waitMs = (now < tickAt) ? std::chrono::duration_cast<std::chrono::milliseconds>(tickAt - now).count() : 0;
+        if (waitMs > 0) {
+            app.rt.pollSockets((int)waitMs);
+        }
+        else {
+            app.rt.pollSockets(0);
+            if (now < tickAt) std::this_thread::sleep_until(tickAt);
+        }
+
+        app.rt.pumpCallbacks();
+        app.host.pumpNetwork();
+
+        now = Clock::now();
+        if (now >= tickAt) {
+            maxLate = std::max(maxLate, now - tickAt);
+            statsTicks += (uint32_t)app.host.updateSim(std::chrono::duration<float>(now - lastSim).count(), 0, 0);
+            lastSim = now;
+        }
+
+        if (app.announcing) {
+            app.lobby.pump();
+            if (now >= nextHeartbeat) {
+                nextHeartbeat = now + std::chrono::seconds(1);
+                app.lobby.sendHeartbeat((uint16_t)std::clamp((int)app.host.curPlayers(), 1, 3));
+            }
+        }
+
+        if (statsInterval.count() > 0 && now >= statsFrom + statsInterval) {
+            using namespace std::chrono;
+            const double secs = duration<double>(now - statsFrom).count();
+            std::cout << "[GameServer] players=" << (int)app.host.curPlayers() - 1 << " tick=" << app.host.serverTick()
+                << " rate=" << (uint32_t)(statsTicks / secs + 0.5) << "/s"
+                << " max late=" << duration_cast<microseconds>(maxLate).count() << "us\n";
+
+            netStats.clear();
+            app.host.drainNetStats(netStats);
+            for (const auto& c : netStats) {
+                const uint32_t settled = c.snapsAcked + c.snapsLost;
+                std::cout << "[GameServer] client " << (int)c.id << ": " << (uint32_t)(c.bytes / secs + 0.5) << " B/s"
+                    << " snaps full=" << c.fullSnaps << " delta=" << c.deltaSnaps
+                    << " loss=" << (settled ? (100 * c.snapsLost + settled / 2) / settled : 0) << "%"
+                    << " inputs lost=" << c.inputsLost << "\n";
+            }
+            statsFrom = now;
+            statsTicks = 0;
+            maxLate = Clock::duration{};
+        }
+    }
+}
\ No newline at end of file
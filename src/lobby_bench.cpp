@@ -0,0 +1,348 @@
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <memory>
+#include <random>
+#include <thread>
+#include <unordered_map>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+#include "net/NetCommon.hpp"
+#include "net/LobbyServer.hpp"
+#include "net/LobbyClient.hpp"
+#include "net/LatencyHistogram.hpp"
+
+// Headless lobby load generator: a LobbyServer plus simulated hosts (Announce, Heartbeat,
+// disconnect + Claim) and browsers (ListReq at a fixed rate) in one process over loopback.
+// Everything but the lobby's worker threads runs on this thread, so CPU/RSS include the clients.
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchConfig {
+    uint16_t port = 27110;
+    uint32_t workers = 1;
+    int announcers = 1000;
+    int browsers = 200;
+    double listRate = 2.0;   // ListReq per browser per second
+    double claimRate = 2.0;  // host migrations (disconnect + Claim) per second
+    int warmupSec = 5;
+    int durationSec = 30;
+};
+
+struct SimHost {
+    std::unique_ptr<LobbyClient> lc;
+    uint64_t sessionKey{ 0 };
+    Clock::time_point nextHeartbeat{};
+    bool claimPending{ false }; // reconnected; send Claim once connected
+};
+
+struct SimBrowser {
+    std::unique_ptr<LobbyClient> lc;
+    Clock::time_point nextReq{};
+    Clock::time_point sentAt{};
+    uint32_t respSeen{ 0 };
+    bool outstanding{ false };
+};
+
+struct BenchStats {
+    uint64_t listReqs = 0;
+    uint64_t listResps = 0;
+    uint64_t timeouts = 0;
+    uint64_t heartbeats = 0;
+    uint64_t claims = 0;
+    LatencyHistogram clientLatency; // ListReq send -> ListResp applied, as seen by the browser
+};
+
+struct BenchApp
+{
+    NetRuntime rt;
+    LobbyServer lobby;
+    std::unordered_map<HSteamNetConnection, LobbyClient*> clients;
+
+    static BenchApp* self;
+
+    static void onConnStatus(SteamNetConnectionStatusChangedCallback_t* info)
+    {
+        if (!self) return;
+        if (info->m_info.m_hListenSocket == self->lobby.listenSocket()) {
+            self->lobby.onConnStatusChanged(info);
+            return;
+        }
+        auto it = self->clients.find(info->m_hConn);
+        if (it != self->clients.end()) it->second->onConnStatusChanged(info);
+    }
+};
+
+BenchApp* BenchApp::self = nullptr;
+
+static double processCpuSeconds()
+{
+#ifdef _WIN32
+    FILETIME created, exited, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user)) return 0.0;
+    auto secs = [](const FILETIME& f) { return (double)(((uint64_t)f.dwHighDateTime << 32) | f.dwLowDateTime) * 1e-7; };
+    return secs(kernel) + secs(user);
+#else
+    rusage ru{};
+    getrusage(RUSAGE_SELF, &ru);
+    return (double)ru.ru_utime.tv_sec + ru.ru_utime.tv_usec * 1e-6 + (double)ru.ru_stime.tv_sec + ru.ru_stime.tv_usec * 1e-6;
+#endif
+}
+
+static double peakRssMb()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc{};
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return 0.0;
+    return (double)pmc.PeakWorkingSetSize / (1024.0 * 1024.0);
+#else
+    rusage ru{};
+    getrusage(RUSAGE_SELF, &ru);
+#if defined(__APPLE__)
+    return (double)ru.ru_maxrss / (1024.0 * 1024.0); // bytes
+#else
+    return (double)ru.ru_maxrss / 1024.0; // KB
+#endif
+#endif
+}
+
+// Every simulated client holds its own UDP socket
+static void raiseFdLimit()
+{
+#ifndef _WIN32
+    rlimit rl{};
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+#endif
+}
+
+static void report(BenchApp& app, const BenchConfig& cfg, BenchStats& st, double windowSec, double cpuSec, size_t listSize)
+{
+    LatencyHistogram serverLatency;
+    app.lobby.drainListLatency(serverLatency);
+
+    std::cout << "[Bench] workers=" << cfg.workers << " hosts=" << cfg.announcers << " browsers=" << cfg.browsers
+        << " listRate=" << cfg.listRate << "/s window=" << windowSec << "s\n";
+    std::cout << "[Bench] ListReq sent=" << st.listReqs << " answered=" << st.listResps
+        << " (" << (uint64_t)(st.listResps / windowSec) << "/s) timeouts=" << st.timeouts
+        << " last list=" << listSize << " entries\n";
+    std::cout << "[Bench] heartbeats=" << st.heartbeats << " (" << (uint64_t)(st.heartbeats / windowSec) << "/s)"
+        << " claims=" << st.claims << "\n";
+
+    const auto& c = st.clientLatency;
+    std::cout << "[Bench] client list latency p50=" << c.percentile(0.50) << "us p90=" << c.percentile(0.90)
+        << "us p99=" << c.percentile(0.99) << "us max=" << c.max() << "us\n";
+    std::cout << "[Bench] server list latency p50=" << serverLatency.percentile(0.50) << "us p99=" << serverLatency.percentile(0.99)
+        << "us max=" << serverLatency.max() << "us n=" << serverLatency.count() << "\n";
+
+    const lobby::StatsResp sr = app.lobby.statsReport();
+    if (sr.windowMs) {
+        std::cout << "[Bench] server pump p50=" << sr.pumpP50Us << "us p99=" << sr.pumpP99Us << "us max=" << sr.pumpMaxUs
+            << "us cleanup max=" << sr.cleanupMaxUs << "us list bytes p99=" << sr.listBytesP99
+            << " (last " << sr.windowMs / 1000 << "s stats window)\n";
+
+        uint64_t dropped = 0;
+        for (uint32_t d : sr.dropped) dropped += d;
+        if (dropped > 0) {
+            std::cout << "[Bench] server rate-limited " << dropped << " msgs (ListReq " << sr.dropped[(size_t)lobby::Type::ListReq]
+                << "), lower --list-rate to measure unthrottled\n";
+        }
+    }
+    std::cout << "[Bench] cpu=" << cpuSec << "s (" << (int)(100.0 * cpuSec / windowSec) << "% of one core)"
+        << " peak rss=" << (int)peakRssMb() << "MB\n";
+}
+
+int main(int argc, char** argv)
+{
+    BenchConfig cfg;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const std::string s = argv[i];
+            if (s == "--port" && i + 1 < argc) cfg.port = (uint16_t)std::stoi(argv[++i]);
+            else if (s == "--workers" && i + 1 < argc) cfg.workers = (uint32_t)std::stoul(argv[++i]);
+            else if (s == "--hosts" && i + 1 < argc) cfg.announcers = std::stoi(argv[++i]);
+            else if (s == "--browsers" && i + 1 < argc) cfg.browsers = std::stoi(argv[++i]);
+            else if (s == "--list-rate" && i + 1 < argc) cfg.listRate = std::stod(argv[++i]);
+            else if (s == "--claim-rate" && i + 1 < argc) cfg.claimRate = std::stod(argv[++i]);
+            else if (s == "--warmup" && i + 1 < argc) cfg.warmupSec = std::stoi(argv[++i]);
+            else if (s == "--duration" && i + 1 < argc) cfg.durationSec = std::stoi(argv[++i]);
+            else throw std::invalid_argument(s);
+        }
+        if (cfg.listRate <= 0.0) throw std::invalid_argument("--list-rate");
+    }
+    catch (...) {
+        std::cerr << "Usage: RLO_LobbyBench [--port P] [--workers N] [--hosts N] [--browsers N]\n"
+            "                      [--list-rate R] [--claim-rate R] [--warmup S] [--duration S]\n";
+        return 2;
+    }
+
+    raiseFdLimit();
+
+    BenchApp app;
+    BenchApp::self = &app;
+
+    NetRuntimeConfig rtCfg;
+    rtCfg.debugLevel = k_ESteamNetworkingSocketsDebugOutputType_Warning; // thousands of conns; keep it quiet
+
+    if (!app.rt.init(rtCfg)) {
+        std::cerr << "NetRuntime init failed\n";
+        return 1;
+    }
+    app.rt.setConnStatusRouter(&BenchApp::onConnStatus);
+
+    if (!app.lobby.start(app.rt.iface(), cfg.port, cfg.workers)) {
+        std::cerr << "Failed to start lobby server on UDP " << cfg.port << "\n";
+        app.rt.shutdown();
+        return 3;
+    }
+
+    ISteamNetworkingSockets* iface = app.rt.iface();
+    const std::string lobbyAddr = "127.0.0.1:" + std::to_string(cfg.port);
+
+    std::mt19937 rng{ std::random_device{}() };
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    const auto heartbeatEvery = std::chrono::seconds(1);
+    const auto reqEvery = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / cfg.listRate));
+    const auto reqTimeout = std::chrono::seconds(5);
+    constexpr int kConnectsPerTick = 100; // don't hit the lobby with every handshake at once
+
+    std::vector<SimHost> hosts(cfg.announcers);
+    std::vector<SimBrowser> browsers(cfg.browsers);
+    int hostsStarted = 0;
+    int browsersStarted = 0;
+
+    auto startHost = [&](SimHost& h, int idx, uint64_t claimKey) {
+        h.lc = std::make_unique<LobbyClient>();
+        if (!claimKey) h.lc->setAnnounceInfo((uint16_t)(27200 + idx % 1000), 3, (uint32_t)idx, "bench" + std::to_string(idx));
+        if (!h.lc->connect(iface, lobbyAddr, LobbyClient::Role::Announcer)) return;
+        app.clients[h.lc->conn()] = h.lc.get();
+        h.sessionKey = claimKey ? claimKey : h.lc->sessionKey();
+        h.claimPending = (claimKey != 0);
+        h.nextHeartbeat = Clock::now() + std::chrono::duration_cast<Clock::duration>(heartbeatEvery * unit(rng));
+    };
+
+    auto startBrowser = [&](SimBrowser& b) {
+        b.lc = std::make_unique<LobbyClient>();
+        if (!b.lc->connect(iface, lobbyAddr, LobbyClient::Role::Browser)) return;
+        app.clients[b.lc->conn()] = b.lc.get();
+        b.nextReq = Clock::now() + std::chrono::duration_cast<Clock::duration>(reqEvery * unit(rng));
+    };
+
+    BenchStats st;
+    size_t lastListSize = 0;
+    double claimBudget = 0.0;
+
+    const auto t0 = Clock::now();
+    const auto measureFrom = t0 + std::chrono::seconds(cfg.warmupSec);
+    const auto measureTo = measureFrom + std::chrono::seconds(cfg.durationSec);
+    bool measuring = false;
+    double cpuAtStart = 0.0;
+    auto lastTick = t0;
+
+    std::cout << "[Bench] warming up " << cfg.warmupSec << "s, then measuring " << cfg.durationSec << "s\n";
+
+    for (;;) {
+        const auto now = Clock::now();
+        if (now >= measureTo) break;
+
+        if (!measuring && now >= measureFrom) {
+            measuring = true;
+            st = BenchStats{};
+            LatencyHistogram discard;
+            app.lobby.drainListLatency(discard);
+            cpuAtStart = processCpuSeconds();
+        }
+
+        // Ramp up connections
+        for (int n = 0; n < kConnectsPerTick && hostsStarted < cfg.announcers; ++n, ++hostsStarted) startHost(hosts[hostsStarted], hostsStarted, 0);
+        for (int n = 0; n < kConnectsPerTick && browsersStarted < cfg.browsers; ++n, ++browsersStarted) startBrowser(browsers[browsersStarted]);
+
+        app.rt.pumpCallbacks();
+        app.lobby.pump();
+
+        // Hosts: heartbeat once a second; a few per second drop their lobby conn and Claim back
+        for (int i = 0; i < hostsStarted; ++i) {
+            auto& h = hosts[i];
+            if (!h.lc) continue;
+            h.lc->pump();
+            if (!h.lc->isConnected()) continue;
+
+            if (h.claimPending) {
+                h.lc->setAnnounceInfo(h.sessionKey, (uint16_t)(27200 + i % 1000), 3, (uint32_t)i, "bench" + std::to_string(i));
+                h.lc->sendClaimNow();
+                h.claimPending = false;
+                ++st.claims;
+            }
+            if (now >= h.nextHeartbeat) {
+                h.lc->sendHeartbeat((uint16_t)(1 + rng() % 3));
+                h.nextHeartbeat += heartbeatEvery;
+                ++st.heartbeats;
+            }
+        }
+
+        claimBudget += cfg.claimRate * std::chrono::duration<double>(now - lastTick).count();
+        lastTick = now;
+        while (claimBudget >= 1.0 && hostsStarted > 0) {
+            claimBudget -= 1.0;
+            const int i = (int)(rng() % (uint32_t)hostsStarted);
+            auto& h = hosts[i];
+            if (!h.lc || !h.lc->isConnected() || h.claimPending) continue;
+
+            app.clients.erase(h.lc->conn());
+            h.lc->disconnect("bench migrate");
+            startHost(h, i, h.sessionKey);
+        }
+
+        // Browsers: one ListReq in flight each, at listRate
+        for (int i = 0; i < browsersStarted; ++i) {
+            auto& b = browsers[i];
+            if (!b.lc) continue;
+            b.lc->pump();
+
+            std::vector<lobby::SessionEntry> list;
+            if (b.lc->popLatestList(list)) lastListSize = list.size();
+
+            if (b.outstanding && b.lc->listResponses() != b.respSeen) {
+                b.outstanding = false;
+                ++st.listResps;
+                st.clientLatency.record(std::chrono::duration_cast<std::chrono::microseconds>(now - b.sentAt).count());
+            }
+            else if (b.outstanding && now - b.sentAt > reqTimeout) {
+                b.outstanding = false;
+                ++st.timeouts;
+            }
+
+            if (!b.outstanding && b.lc->isConnected() && now >= b.nextReq) {
+                b.respSeen = b.lc->listResponses();
+                b.lc->requestList();
+                b.sentAt = now;
+                b.outstanding = true;
+                b.nextReq = std::max(b.nextReq + reqEvery, now);
+                ++st.listReqs;
+            }
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    report(app, cfg, st, (double)cfg.durationSec, processCpuSeconds() - cpuAtStart, lastListSize);
+
+    for (auto& h : hosts) if (h.lc) h.lc->disconnect("bench done");
+    for (auto& b : browsers) if (b.lc) b.lc->disconnect("bench done");
+    app.lobby.stop();
+    app.rt.shutdown();
+    return 0;
+}
\ No newline at end of file
@@ -1,25 +1,24 @@
 #include <iostream>
-#include <thread>
 #include <chrono>
 #include <string>
+#include <vector>
 
 #include "net/NetCommon.hpp"
 #include "net/LobbyServer.hpp"
+#include "net/LobbyLoop.hpp"
 
 struct LobbyApp
 {
     NetRuntime rt;
     LobbyServer lobby;
-    HSteamListenSocket listenSock{ k_HSteamListenSocket_Invalid };
 
     static LobbyApp* self;
 
+    // Listen-socket conns and the lobby's own links to its peers; it ignores anything else
     static void onConnStatus(SteamNetConnectionStatusChangedCallback_t* info)
     {
         if (!self) return;
-        if (info->m_info.m_hListenSocket == self->listenSock) {
-            self->lobby.onConnStatusChanged(info);
-        }
+        self->lobby.onConnStatusChanged(info);
     }
 };
 
@@ -28,37 +27,51 @@ LobbyApp* LobbyApp::self = nullptr;
 int main(int argc, char** argv)
 {
     uint16_t port = 27010;
-    if (argc >= 2) {
-        try { port = static_cast<uint16_t>(std::stoi(argv[1])); }
-        catch (...) {
-            std::cerr << "Usage: RLO_LobbyServer [port]\n";
-            return 2;
+    uint32_t workers = 1;
+    std::string snapshotFile = "lobby_sessions.bin";
+    std::vector<std::string> peers;
+    LobbyLoopConfig loopCfg;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const std::string s = argv[i];
+            if (s == "--fixed-sleep-ms" && i + 1 < argc) loopCfg.fixedSleep = std::chrono::milliseconds(std::stoi(argv[++i]));
+            else if (s == "--stats-interval" && i + 1 < argc) loopCfg.statsInterval = std::chrono::seconds(std::stoi(argv[++i]));
+            else if (s == "--workers" && i + 1 < argc) workers = (uint32_t)std::stoul(argv[++i]);
+            else if (s == "--snapshot" && i + 1 < argc) snapshotFile = argv[++i];
+            else if (s == "--no-snapshot") snapshotFile.clear();
+            else if (s == "--peer" && i + 1 < argc) peers.push_back(argv[++i]);
+            else port = static_cast<uint16_t>(std::stoi(s));
         }
     }
+    catch (...) {
+        std::cerr << "Usage: RLO_LobbyServer [port] [--fixed-sleep-ms N] [--stats-interval S] [--workers N] [--snapshot FILE | --no-snapshot] [--peer HOST:PORT]...\n";
+        return 2;
+    }
 
     LobbyApp app;
     LobbyApp::self = &app;
 
-    if (!app.rt.init()) {
+    NetRuntimeConfig rtCfg;
+    rtCfg.manualPoll = (loopCfg.fixedSleep.count() == 0);
+
+    if (!app.rt.init(rtCfg)) {
         std::cerr << "NetRuntime init failed\n";
         return 1;
     }
 
     app.rt.setConnStatusRouter(&LobbyApp::onConnStatus);
 
-    if (!app.lobby.start(app.rt.iface(), port)) {
+    app.lobby.setSnapshotFile(snapshotFile);
+    app.lobby.setPeers(peers);
+    if (!app.lobby.start(app.rt.iface(), port, workers)) {
         std::cerr << "Failed to start lobby server on UDP " << port << "\n";
         app.rt.shutdown();
         return 3;
     }
 
-    app.listenSock = app.lobby.listenSocket();
-
     std::cout << "[LobbyServer] Running on UDP " << port << "\n";
 
-    for (;;) {
-        app.rt.pumpCallbacks();
-        app.lobby.pump();
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
-    }
+    LobbyLoop loop(app.rt, app.lobby, loopCfg);
+    loop.run();
 }
\ No newline at end of file
@@ -10,6 +10,7 @@
 
 #include "net/NetCommon.hpp"
 #include "net/LobbyServer.hpp"
+#include "net/LobbyLoop.hpp"
 #include "net/LobbyClient.hpp"
 #include "net/GameHost.hpp"
 #include "net/GameClient.hpp"
@@ -28,6 +29,9 @@ struct Args {
 
     std::string lobbyAddr;     // e.g. "1.2.3.4:27010"
     std::string name = "Run #1";
+
+    GameHostConfig hostCfg;    // --tick-hz, --snap-every (also used after a migration)
+    GameClientConfig clientCfg; // --interp-ms, --extrap-ms, --input-frames
 };
 
 static Args parseArgs(int argc, char** argv) {
@@ -42,6 +46,11 @@ static Args parseArgs(int argc, char** argv) {
         else if (s == "--pick" && i + 1 < argc) { a.pickIndex = std::stoi(argv[++i]); }
         else if (s == "--lobby" && i + 1 < argc) { a.lobbyAddr = argv[++i]; }
         else if (s == "--name" && i + 1 < argc) { a.name = argv[++i]; }
+        else if (s == "--tick-hz" && i + 1 < argc) { a.hostCfg.tickHz = (uint32_t)std::stoul(argv[++i]); }
+        else if (s == "--snap-every" && i + 1 < argc) { a.hostCfg.snapEveryTicks = (uint32_t)std::stoul(argv[++i]); }
+        else if (s == "--interp-ms" && i + 1 < argc) { a.clientCfg.interpDelay = std::stoi(argv[++i]) / 1000.f; }
+        else if (s == "--extrap-ms" && i + 1 < argc) { a.clientCfg.maxExtrapolation = std::stoi(argv[++i]) / 1000.f; }
+        else if (s == "--input-frames" && i + 1 < argc) { a.clientCfg.inputRedundancy = (uint8_t)std::stoul(argv[++i]); }
     }
     return a;
 }
@@ -114,7 +123,10 @@ int main(int argc, char** argv) {
     App app;
     App::self = &app;
 
-    if (!app.rt.init()) return 1;
+    // A dedicated lobby blocks on its sockets; the interactive modes keep the GNS service thread
+    NetRuntimeConfig rtCfg;
+    rtCfg.manualPoll = args.lobbyServer;
+    if (!app.rt.init(rtCfg)) return 1;
     app.rt.setConnStatusRouter(&App::routeConnStatus);
 
     auto* iface = app.rt.iface();
@@ -177,12 +189,8 @@ int main(int argc, char** argv) {
 
         std::cout << "[LobbyServer] Running on UDP " << args.lobbyPort << "\n";
 
-        for (;;)
-        {
-            app.rt.pumpCallbacks();
-            app.lobbyServer.pump();
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
-        }
+        LobbyLoop loop(app.rt, app.lobbyServer);
+        loop.run();
     }
 
 
@@ -190,7 +198,7 @@ int main(int argc, char** argv) {
     if (args.host) {
         app.hasGameHost = true;
         const uint32_t seed = 0xC0FFEEu; // placeholder; later: random per run
-        if (!app.gameHost.start(iface, args.gamePort, seed)) return 4;
+        if (!app.gameHost.start(iface, args.gamePort, seed, args.hostCfg)) return 4;
 
         // Optional: announce to lobby
         if (!args.lobbyAddr.empty()) {
@@ -376,6 +384,7 @@ int main(int argc, char** argv) {
 
         app.hasLobbyClient = true;
         if (!app.lobbyClient.connect(iface, args.lobbyAddr, LobbyClient::Role::Browser)) return 7;
+        app.lobbyClient.subscribe(); // lobby pushes list changes; no polling
 
         // One window: lobby screen then gameplay
         sf::RenderWindow window(sf::VideoMode({ 1280U, 720U }, 32U), "RLO - Lobby");
@@ -426,10 +435,9 @@ int main(int argc, char** argv) {
             return t;
             };
 
-        auto entryAddrStr = [](const lobby::SessionEntry& e) -> std::string {
+        auto entryAddrStr = [&](const lobby::SessionEntry& e) -> std::string {
             SteamNetworkingIPAddr a;
-            a.Clear();
-            a.SetIPv4(e.ipv4_host_order, e.gamePort);
+            if (!app.lobbyClient.hostAddress(e, a)) return std::string();
             char buf[SteamNetworkingIPAddr::k_cchMaxString]{};
             a.ToString(buf, sizeof(buf), true);
             return std::string(buf);
@@ -465,21 +473,16 @@ int main(int argc, char** argv) {
         game::Snap snap{};
         bool hasSnap = false;
 
-        float listReqAccum = 0.f;
-
-        sf::Clock clock;
-
         int selectedIdx = -1;
 
         sf::Clock uiClock;
+        sf::Clock frameClock;
         float lastClickAt = -1000.f;
         int lastClickIdx = -1;
 
-        auto tryJoinIndex = [&](int idx)
+        // idx = row in `list`, or -1 when the lobby picked the session (QuickMatch)
+        auto tryJoinEntry = [&](const lobby::SessionEntry& e, int idx)
             {
-                if (idx < 0 || idx >= (int)list.size()) return;
-
-                const auto& e = list[idx];
                 const bool open =
                     (e.state == lobby::SessionState::Open) &&
                     (e.curPlayers < e.maxPlayers);
@@ -487,9 +490,13 @@ int main(int argc, char** argv) {
                 if (!open) return;
 
                 const std::string hostStr = entryAddrStr(e);
+                if (hostStr.empty()) {
+                    std::cerr << "No address for session \"" << e.name << "\"\n";
+                    return;
+                }
 
                 app.hasGameClient = true;
-                if (!app.gameClient.connect(iface, hostStr.c_str())) {
+                if (!app.gameClient.connect(iface, hostStr.c_str(), args.clientCfg)) {
                     std::cerr << "Failed to connect to host: " << hostStr << "\n";
                     app.hasGameClient = false;
                     return;
@@ -509,6 +516,12 @@ int main(int argc, char** argv) {
                 // (You can disconnect later when game actually starts.)
             };
 
+        auto tryJoinIndex = [&](int idx)
+            {
+                if (idx < 0 || idx >= (int)list.size()) return;
+                tryJoinEntry(list[idx], idx);
+            };
+
 
         World world;
         uint32_t worldSeed = 0xC0FFEEu; // Will be synced from server via savedWorldSeed
@@ -566,6 +579,13 @@ int main(int argc, char** argv) {
                         if (!args.browseOnly)
                             tryJoinIndex(selectedIdx);
                     }
+
+                    // Quick match: the lobby picks (and briefly holds a slot in) the fullest open game
+                    if (phase == Phase::LobbyBrowse && kp->code == sf::Keyboard::Key::Q)
+                    {
+                        if (!args.browseOnly && app.lobbyClient.isConnected())
+                            app.lobbyClient.requestQuickMatch();
+                    }
                 }
 
                 // Mouse join only in LobbyBrowse
@@ -611,8 +631,6 @@ int main(int argc, char** argv) {
                 }
             }
 
-            const float dt = clock.restart().asSeconds();
-
             // Always pump callbacks
             app.rt.pumpCallbacks();
 
@@ -624,17 +642,26 @@ int main(int argc, char** argv) {
 
                 app.lobbyClient.pump();
 
-                listReqAccum += dt;
-                if (app.lobbyClient.isConnected() && listReqAccum >= 0.5f) {
-                    listReqAccum = 0.f;
-                    app.lobbyClient.requestList();
-                }
-
                 std::vector<lobby::SessionEntry> tmp;
                 if (app.lobbyClient.popLatestList(tmp)) {
                     list = std::move(tmp);
                     haveList = true;
                 }
+
+                bool qmFound = false;
+                lobby::SessionEntry qm{};
+                if (app.lobbyClient.popQuickMatch(qmFound, qm) && phase == Phase::LobbyBrowse) {
+                    if (qmFound) {
+                        int idx = -1;
+                        for (int i = 0; i < (int)list.size(); ++i) {
+                            if (list[i].sessionKey == qm.sessionKey) { idx = i; break; }
+                        }
+                        tryJoinEntry(qm, idx);
+                    }
+                    else {
+                        std::cout << "[Client] Quick match: no open game right now\n";
+                    }
+                }
             }
 
             // While waiting, pump the game connection and auto-transition on StartGame
@@ -670,7 +697,7 @@ int main(int argc, char** argv) {
                 window.clear(sf::Color(16, 16, 22));
 
                 if (hasFont) {
-                    window.draw(mkText("Lobby (click an OPEN game to join)    R=Refresh   Esc=Quit", 20, { left, 30.f }));
+                    window.draw(mkText("Lobby (click an OPEN game to join)    Q=Quick match   R=Refresh   Esc=Quit", 20, { left, 30.f }));
                     window.draw(mkText(("Lobby: " + args.lobbyAddr), 16, { left, 55.f }));
                 }
 
@@ -794,7 +821,7 @@ int main(int argc, char** argv) {
                 // Try to start hosting on a dynamic port (OS assigns)
                 uint16_t dynamicPort = 0; // 0 = OS picks available port
 
-                if (app.gameHost.start(iface, dynamicPort, savedWorldSeed)) {
+                if (app.gameHost.start(iface, dynamicPort, savedWorldSeed, args.hostCfg)) {
 
                     // Successfully hosting! Get the actual port assigned
                     uint16_t actualPort = app.gameHost.port();
@@ -852,7 +879,7 @@ int main(int argc, char** argv) {
                                 std::string newHostAddr = entryAddrStr(e);
 
                                 app.hasGameClient = true;
-                                if (app.gameClient.connect(iface, newHostAddr)) {
+                                if (app.gameClient.connect(iface, newHostAddr, args.clientCfg)) {
                                     phase = Phase::InGame;
                                     reconnectAttempts = 0;
                                     std::cout << "[Migration] Reconnected to new host.\n";
@@ -917,7 +944,7 @@ int main(int argc, char** argv) {
                     // Force immediate list refresh
                     list.clear();
                     haveList = false;
-                    listReqAccum = 999.f; // Will trigger immediate request on next frame
+                    app.lobbyClient.subscribe(); // Full list gets pushed as soon as we're connected
 
                     phase = Phase::LobbyBrowse;
                     window.setTitle("RLO - Lobby");
@@ -954,12 +981,14 @@ int main(int argc, char** argv) {
             if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::S)) my = +1;
 
             app.gameClient.pumpNetwork();
-            app.gameClient.sendInput(mx, my);
+            app.gameClient.updatePrediction(frameClock.restart().asSeconds(), mx, my);
 
-            game::Snap s2{};
-            if (app.gameClient.popLatestSnap(s2)) {
-                snap = s2;
+            // Others interpolated a little behind the host, so 20 Hz snapshots still move
+            // smoothly; our own player is predicted, so it answers the keys at once
+            if (app.gameClient.sampleView(snap)) {
                 hasSnap = true;
+                game::PlayerState self{};
+                if (app.gameClient.predictedSelf(self)) snap.players[self.id] = self;
             }
 
             window.clear(sf::Color(20, 20, 26));
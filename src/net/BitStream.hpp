@@ -0,0 +1,73 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// LSB-first bit packing for the game protocol's compact messages. Values are written in the
+// low `bits` bits (1..32); the reader reports a short buffer through ok() instead of throwing.
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : m_out(out) {}
+    ~BitWriter() { flush(); }
+
+    void write(uint32_t value, int bits) {
+        if (bits < 32) value &= (1u << bits) - 1u;
+        m_acc |= (uint64_t)value << m_count;
+        m_count += bits;
+        while (m_count >= 8) {
+            m_out.push_back((uint8_t)m_acc);
+            m_acc >>= 8;
+            m_count -= 8;
+        }
+    }
+    void writeBit(bool b) { write(b ? 1u : 0u, 1); }
+    void writeSigned(int32_t value, int bits) { write((uint32_t)value, bits); } // two's complement
+
+    // Pads the last byte with zeros; further writes start a new byte
+    void flush() {
+        if (m_count > 0) m_out.push_back((uint8_t)m_acc);
+        m_acc = 0;
+        m_count = 0;
+    }
+
+private:
+    std::vector<uint8_t>& m_out;
+    uint64_t m_acc{ 0 };
+    int m_count{ 0 };
+};
+
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+
+    uint32_t read(int bits) {
+        while (m_count < bits) {
+            if (m_pos == m_size) {
+                m_ok = false;
+                return 0;
+            }
+            m_acc |= (uint64_t)m_data[m_pos++] << m_count;
+            m_count += 8;
+        }
+        const uint32_t v = (bits < 32) ? (uint32_t)(m_acc & ((1ull << bits) - 1ull)) : (uint32_t)m_acc;
+        m_acc >>= bits;
+        m_count -= bits;
+        return v;
+    }
+    bool readBit() { return read(1) != 0; }
+    int32_t readSigned(int bits) {
+        const uint32_t v = read(bits);
+        const uint32_t sign = 1u << (bits - 1);
+        return (int32_t)((v ^ sign) - sign);
+    }
+
+    bool ok() const { return m_ok; }
+
+private:
+    const uint8_t* m_data;
+    size_t m_size;
+    size_t m_pos{ 0 };
+    uint64_t m_acc{ 0 };
+    int m_count{ 0 };
+    bool m_ok{ true };
+};
\ No newline at end of file
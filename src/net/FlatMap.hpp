@@ -0,0 +1,115 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Open-addressing hash map for small trivially copyable keys and values: one flat array, linear
+// probing, power-of-two capacity, at most 3/4 full. Erase shifts the following run back instead of
+// leaving tombstones, so lookups never slow down as entries come and go. K{} marks an empty bucket
+// and can't be stored (session keys and connection handles are never 0).
+template <class K, class V>
+class FlatMap {
+public:
+    V* find(K key) {
+        if (m_size == 0) return nullptr;
+        for (size_t i = home(key);; i = (i + 1) & m_mask) {
+            Bucket& b = m_buckets[i];
+            if (b.key == key) return &b.value;
+            if (b.key == K{}) return nullptr;
+        }
+    }
+    const V* find(K key) const { return const_cast<FlatMap*>(this)->find(key); }
+
+    // Value for key, inserting V{} if it's missing. Invalidates pointers from find() if it grows.
+    V& insert(K key, bool& inserted) {
+        if ((m_size + 1) * 4 > m_buckets.size() * 3) grow();
+        for (size_t i = home(key);; i = (i + 1) & m_mask) {
+            Bucket& b = m_buckets[i];
+            inserted = (b.key == K{});
+            if (b.key == key) return b.value;
+            if (inserted) {
+                b.key = key;
+                b.value = V{};
+                ++m_size;
+                return b.value;
+            }
+        }
+    }
+    V& operator[](K key) {
+        bool inserted;
+        return insert(key, inserted);
+    }
+
+    bool erase(K key) {
+        if (m_size == 0) return false;
+        size_t i = home(key);
+        while (m_buckets[i].key != key) {
+            if (m_buckets[i].key == K{}) return false;
+            i = (i + 1) & m_mask;
+        }
+
+        // Pull back every later entry of the run that may live in the hole (its home isn't
+        // cyclically between the hole and where it sits now)
+        for (size_t j = (i + 1) & m_mask; m_buckets[j].key != K{}; j = (j + 1) & m_mask) {
+            const size_t h = home(m_buckets[j].key);
+            const bool stays = (i <= j) ? (i < h && h <= j) : (i < h || h <= j);
+            if (stays) continue;
+            m_buckets[i] = m_buckets[j];
+            i = j;
+        }
+        m_buckets[i] = Bucket{};
+        --m_size;
+        return true;
+    }
+
+    template <class F>
+    void forEach(F&& f) const {
+        for (const Bucket& b : m_buckets) {
+            if (b.key != K{}) f(b.key, b.value);
+        }
+    }
+
+    void clear() {
+        m_buckets.clear();
+        m_mask = 0;
+        m_size = 0;
+    }
+
+    size_t size() const { return m_size; }
+    size_t bytes() const { return m_buckets.capacity() * sizeof(Bucket); }
+
+private:
+    struct Bucket {
+        K key{};
+        V value{};
+    };
+
+    // Keys may share low or high bits (shard choice uses some of them), so mix all 64 first
+    static uint64_t mix(uint64_t k) {
+        k ^= k >> 33;
+        k *= 0xFF51AFD7ED558CCDull;
+        k ^= k >> 33;
+        return k;
+    }
+    size_t home(K key) const { return (size_t)mix((uint64_t)key) & m_mask; }
+
+    void grow() {
+        std::vector<Bucket> old;
+        old.swap(m_buckets);
+        m_buckets.resize(old.empty() ? kMinCapacity : old.size() * 2);
+        m_mask = m_buckets.size() - 1;
+
+        for (const Bucket& b : old) {
+            if (b.key == K{}) continue;
+            size_t i = home(b.key);
+            while (m_buckets[i].key != K{}) i = (i + 1) & m_mask;
+            m_buckets[i] = b;
+        }
+    }
+
+    static constexpr size_t kMinCapacity = 16;
+
+    std::vector<Bucket> m_buckets;
+    size_t m_mask{ 0 };
+    size_t m_size{ 0 };
+};
\ No newline at end of file
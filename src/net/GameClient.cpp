@@ -1,10 +1,18 @@
 #include "GameClient.hpp"
+#include "BitStream.hpp"
 #include <iostream>
 #include <cstring>
 #include <algorithm>
+#include <iterator>
+#include <cmath>
+#include <vector>
 
-bool GameClient::connect(ISteamNetworkingSockets* iface, const std::string& hostAddr) {
+bool GameClient::connect(ISteamNetworkingSockets* iface, const std::string& hostAddr, const GameClientConfig& cfg) {
     m_iface = iface;
+    m_cfg = cfg;
+    m_cfg.interpDelay = std::max(m_cfg.interpDelay, 0.f);
+    m_cfg.maxExtrapolation = std::max(m_cfg.maxExtrapolation, 0.f);
+    m_cfg.inputRedundancy = std::clamp<uint8_t>(m_cfg.inputRedundancy, 1, game::kMaxInputBatch);
 
     SteamNetworkingIPAddr addr;
     addr.Clear();
@@ -19,6 +27,7 @@ bool GameClient::connect(ISteamNetworkingSockets* iface, const std::string& host
         return false;
     }
 
+    resetSnaps();
     return true;
 }
 
@@ -31,6 +40,91 @@ void GameClient::disconnect(const char* reason) {
     m_connected = false;
     m_myId = 255;
     m_hasSnap = false;
+    resetSnaps();
+}
+
+void GameClient::resetSnaps() {
+    // A seq no host will reach, so empty slots never pass for received ones
+    game::QuantSnap none{};
+    none.seq = UINT32_MAX;
+    m_recv.fill(none);
+    m_anySnap = false;
+    m_ackPending = false;
+    m_timeline.clear();
+    m_clockSynced = false;
+    m_epoch = std::chrono::steady_clock::now();
+
+    m_clientTick = 0;
+    m_pending.clear();
+    m_hasPrediction = false;
+    m_predAccum = 0.0;
+    m_corrX = m_corrY = 0.f;
+}
+
+double GameClient::localTime() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_epoch).count();
+}
+
+void GameClient::syncClock(uint32_t serverTick) {
+    const double sample = (double)serverTick * m_tickDt - localTime();
+    const double err = sample - m_clockOffset;
+
+    // Smooth out arrival jitter; a big jump (host stall, restore) is taken as is
+    if (!m_clockSynced || std::fabs(err) > 0.25) {
+        m_clockOffset = sample;
+        m_clockSynced = true;
+    }
+    else {
+        m_clockOffset += err * 0.05;
+    }
+}
+
+void GameClient::pushTimeline(const game::QuantSnap& q) {
+    // Ordered by tick; a reordered one slots in unless the view is already past it
+    auto it = m_timeline.end();
+    while (it != m_timeline.begin() && (int32_t)(std::prev(it)->serverTick - q.tick) >= 0) --it;
+    if (it != m_timeline.end() && it->serverTick == q.tick) return;
+    if (it == m_timeline.begin() && !m_timeline.empty()) return;
+
+    game::Snap s{};
+    m_codec.dequantize(q, s);
+    m_timeline.insert(it, s);
+    if (m_timeline.size() > kMaxTimeline) m_timeline.pop_front();
+}
+
+bool GameClient::sampleView(game::Snap& out) {
+    if (m_timeline.empty()) return false;
+
+    const double renderTick = (localTime() + m_clockOffset - m_cfg.interpDelay) / m_tickDt;
+
+    // Drop what's behind the render time, keeping the start of the current span (and always
+    // the newest two, which extrapolation runs from)
+    while (m_timeline.size() >= 3 && (double)m_timeline[1].serverTick <= renderTick) m_timeline.pop_front();
+
+    size_t next = 0;
+    while (next < m_timeline.size() && (double)m_timeline[next].serverTick <= renderTick) ++next;
+
+    if (next == 0 || m_timeline.size() < 2) {
+        out = (next == 0) ? m_timeline.front() : m_timeline.back(); // starved, or nothing to blend
+        return true;
+    }
+
+    const game::Snap& a = m_timeline[(next < m_timeline.size()) ? next - 1 : next - 2];
+    const game::Snap& b = m_timeline[(next < m_timeline.size()) ? next : next - 1];
+    const double span = (double)(b.serverTick - a.serverTick);
+
+    // Past the newest snapshot: carry on along the last span, but only for maxExtrapolation
+    double t = renderTick - (double)a.serverTick;
+    if (next == m_timeline.size()) t = std::min(t, span + m_cfg.maxExtrapolation / m_tickDt);
+
+    out = b;
+    for (uint8_t i = 0; i < game::kMaxPlayers; ++i) {
+        const float x = (float)(a.players[i].x + (b.players[i].x - a.players[i].x) * t / span);
+        const float y = (float)(a.players[i].y + (b.players[i].y - a.players[i].y) * t / span);
+        out.players[i].x = std::clamp(x, 0.f, game::kWorldWidth);
+        out.players[i].y = std::clamp(y, 0.f, game::kWorldHeight);
+    }
+    return true;
 }
 
 void GameClient::onConnStatusChanged(SteamNetConnectionStatusChangedCallback_t* info) {
@@ -82,6 +176,19 @@ void GameClient::pumpNetwork() {
             msgs[i]->Release();
         }
     }
+
+    // One ack for everything decoded this pump: the newest snapshot (the only useful baseline)
+    // plus which of the ones before it arrived, for the host's loss count
+    if (m_ackPending && m_connected) {
+        game::SnapAck ack{};
+        ack.type = game::Type::SnapAck;
+        ack.seq = m_latestSeq;
+        for (uint32_t k = 1; k < kSnapHistory; ++k) {
+            if (m_recv[(ack.seq - k) % kSnapHistory].seq == ack.seq - k) ack.earlier |= 1u << (k - 1);
+        }
+        m_iface->SendMessageToConnection(m_conn, &ack, sizeof(ack), k_nSteamNetworkingSend_Unreliable, nullptr);
+    }
+    m_ackPending = false;
 }
 
 void GameClient::handleMessage(const void* data, uint32_t size) {
@@ -95,14 +202,14 @@ void GameClient::handleMessage(const void* data, uint32_t size) {
         std::memcpy(&w, data, sizeof(w));
         m_myId = w.yourId;
         m_worldSeed = w.worldSeed;
+        m_codec = game::SnapCodec(w.posScale);
+        m_tickDt = 1.f / (float)std::max<uint16_t>(w.tickHz, 1);
         std::cout << "[Client] Welcome: myId=" << (int)m_myId << " seed=" << w.worldSeed << "\n";
         return;
     }
 
-    if (type == game::Type::Snap) {
-        if (size < sizeof(game::Snap)) return;
-        std::memcpy(&m_latest, data, sizeof(game::Snap));
-        m_hasSnap = true;
+    if (type == game::Type::SnapDelta) {
+        applySnap((const uint8_t*)data, size);
         return;
     }
     if (type == game::Type::StartGame) {
@@ -124,14 +231,105 @@ void GameClient::sendInput(int8_t mx, int8_t my) {
     if (m_myId > 2) return;
     if (!m_gameStarted) return; // NEW: wait for host StartGame
 
-    game::Input in{};
-    in.type = game::Type::Input;
-    in.clientTick = ++m_clientTick;
-    in.playerId = m_myId;
-    in.moveX = (int8_t)std::clamp<int>(mx, -1, 1);
-    in.moveY = (int8_t)std::clamp<int>(my, -1, 1);
+    m_pending.push_back({ ++m_clientTick, (int8_t)std::clamp<int>(mx, -1, 1), (int8_t)std::clamp<int>(my, -1, 1) });
+    if (m_pending.size() > kMaxPending) m_pending.pop_front();
+
+    // This input plus the ones before it the host hasn't confirmed yet (up to inputRedundancy),
+    // newest first, so a lost packet costs nothing while the next one gets through
+    game::InputBatchHdr hdr{};
+    hdr.type = game::Type::InputBatch;
+    hdr.newestTick = m_clientTick;
+    hdr.count = (uint8_t)std::min<size_t>(m_pending.size(), m_cfg.inputRedundancy);
+
+    std::vector<uint8_t> bytes(sizeof(hdr));
+    std::memcpy(bytes.data(), &hdr, sizeof(hdr));
+    {
+        BitWriter w(bytes);
+        for (auto it = m_pending.rbegin(); it != m_pending.rbegin() + hdr.count; ++it) {
+            w.write((uint32_t)(it->moveX + 1), 2);
+            w.write((uint32_t)(it->moveY + 1), 2);
+        }
+    }
+
+    m_iface->SendMessageToConnection(m_conn, bytes.data(), (uint32_t)bytes.size(), k_nSteamNetworkingSend_Unreliable, nullptr);
+}
+
+void GameClient::updatePrediction(float frameDt, int8_t mx, int8_t my) {
+    if (!m_connected || m_myId > 2 || !m_gameStarted) return;
+    mx = (int8_t)std::clamp<int>(mx, -1, 1);
+    my = (int8_t)std::clamp<int>(my, -1, 1);
+    frameDt = std::max(frameDt, 0.f);
+
+    // Ease out the last correction, half-life 50 ms
+    const float keep = std::pow(0.5f, frameDt / 0.05f);
+    m_corrX *= keep;
+    m_corrY *= keep;
+
+    // Same cadence as the host sim: one input per tick, each predicted as it goes out
+    m_predAccum = std::min(m_predAccum + frameDt, (double)kMaxCatchUpTicks * m_tickDt);
+    while (m_predAccum >= m_tickDt) {
+        m_predAccum -= m_tickDt;
+        sendInput(mx, my);
+        if (m_hasPrediction) game::stepPlayer(m_predicted, mx, my, m_tickDt);
+    }
+}
+
+bool GameClient::predictedSelf(game::PlayerState& out) const {
+    if (!m_hasPrediction) return false;
+    out = m_predicted;
+    out.x = std::clamp(out.x + m_corrX, 0.f, game::kWorldWidth);
+    out.y = std::clamp(out.y + m_corrY, 0.f, game::kWorldHeight);
+    return true;
+}
+
+void GameClient::reconcile(uint32_t inputAck) {
+    while (!m_pending.empty() && (int32_t)(m_pending.front().tick - inputAck) <= 0) m_pending.pop_front();
+
+    // Where the host says we were, plus the inputs it hadn't applied yet
+    game::PlayerState p = m_latest.players[m_myId];
+    for (const auto& in : m_pending) game::stepPlayer(p, in.moveX, in.moveY, m_tickDt);
+
+    // Ease a small misprediction out instead of jumping; a large one is taken as is
+    if (m_hasPrediction) {
+        const float ex = m_predicted.x + m_corrX - p.x;
+        const float ey = m_predicted.y + m_corrY - p.y;
+        const bool small = ex * ex + ey * ey < 64.f * 64.f;
+        m_corrX = small ? ex : 0.f;
+        m_corrY = small ? ey : 0.f;
+    }
+    m_predicted = p;
+    m_hasPrediction = true;
+}
+
+void GameClient::applySnap(const uint8_t* data, uint32_t size) {
+    if (size < sizeof(game::SnapDeltaHdr)) return;
+    game::SnapDeltaHdr hdr{};
+    std::memcpy(&hdr, data, sizeof(hdr));
+
+    const game::QuantSnap* base = nullptr;
+    if (hdr.baseAge) {
+        const uint32_t baseSeq = hdr.seq - hdr.baseAge;
+        const game::QuantSnap& b = m_recv[baseSeq % kSnapHistory];
+        if (b.seq != baseSeq) return; // overwritten already; a later one will do
+        base = &b;
+    }
+
+    game::QuantSnap q{};
+    if (!m_codec.decode(data + sizeof(hdr), size - sizeof(hdr), base, q)) return;
+    q.tick = hdr.serverTick;
+    q.seq = hdr.seq;
+    m_recv[q.seq % kSnapHistory] = q;
+    m_ackPending = true;
+    pushTimeline(q);
 
-    m_iface->SendMessageToConnection(m_conn, &in, sizeof(in), k_nSteamNetworkingSend_Unreliable, nullptr);
+    // A late (reordered) one still serves as a baseline, but doesn't move the view back
+    if (m_anySnap && (int32_t)(q.seq - m_latestSeq) <= 0) return;
+    m_codec.dequantize(q, m_latest);
+    m_latestSeq = q.seq;
+    syncClock(q.tick);
+    if (m_myId < game::kMaxPlayers) reconcile(hdr.inputAck);
+    m_anySnap = true;
+    m_hasSnap = true;
 }
 
 bool GameClient::popLatestSnap(game::Snap& out) {
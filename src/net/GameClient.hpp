@@ -1,5 +1,8 @@
 #pragma once
 #include <string>
+#include <array>
+#include <deque>
+#include <chrono>
 #include <cstdint>
 #include <optional>
 
@@ -9,10 +12,18 @@
 #include <steam/isteamnetworkingutils.h>
 
 #include "GameProtocol.hpp"
+#include "SnapCodec.hpp"
+#include "PlayerMovement.hpp"
+
+struct GameClientConfig {
+    float interpDelay{ 0.1f };      // seconds the view trails the newest snapshot (~2 at 20 Hz)
+    float maxExtrapolation{ 0.1f }; // seconds to run on past the newest one before holding still
+    uint8_t inputRedundancy{ 16 };  // unconfirmed inputs repeated in each input packet
+};
 
 class GameClient {
 public:
-    bool connect(ISteamNetworkingSockets* iface, const std::string& hostAddr);
+    bool connect(ISteamNetworkingSockets* iface, const std::string& hostAddr, const GameClientConfig& cfg = {});
     void disconnect(const char* reason = "bye");
 
     void onConnStatusChanged(SteamNetConnectionStatusChangedCallback_t* info);
@@ -25,13 +36,30 @@ public:
     bool gameStarted() const { return m_gameStarted; }
     uint32_t worldSeed() const { return m_worldSeed; }
 
+    // One tick's input; kept for replay until a snapshot shows the host has applied it
     void sendInput(int8_t mx, int8_t my);
 
+    // Call each frame instead of sendInput(): on the host's tick rate, sends the input and moves
+    // the local player by it right away, so it reacts without waiting a round trip
+    void updatePrediction(float frameDt, int8_t mx, int8_t my);
+    // The local player as predicted (false until the first snapshot); draw it instead of sampleView's
+    bool predictedSelf(game::PlayerState& out) const;
+
     bool popLatestSnap(game::Snap& out);
+
+    // The world as of now minus interpDelay on the host's clock, blended from the snapshots either
+    // side (or extrapolated from the newest two, bounded). False until the first snapshot.
+    bool sampleView(game::Snap& out);
     bool hostDisconnected() const { return m_hostDisconnected; }
     void clearHostDisconnected() { m_hostDisconnected = false; }
 private:
     void handleMessage(const void* data, uint32_t size);
+    void applySnap(const uint8_t* data, uint32_t size);
+    void resetSnaps();
+    void pushTimeline(const game::QuantSnap& q);
+    void syncClock(uint32_t serverTick);
+    double localTime() const;
+    void reconcile(uint32_t inputAck);
 
 private:
     ISteamNetworkingSockets* m_iface{ nullptr };
@@ -44,4 +72,36 @@ private:
     uint32_t m_worldSeed{ 0 };    // NEW
     bool m_hasSnap{ false };
     game::Snap m_latest{};
+
+    // The last snapshots decoded (slot seq % kSnapHistory): the host's deltas refer to these
+    static constexpr uint32_t kSnapHistory = 32;
+    std::array<game::QuantSnap, kSnapHistory> m_recv{};
+    game::SnapCodec m_codec;
+    uint32_t m_latestSeq{ 0 };
+    bool m_anySnap{ false };    // m_latest holds snapshot m_latestSeq, the newest decoded
+    bool m_ackPending{ false }; // acked once per pumpNetwork()
+
+    // Decoded snapshots by tick for sampleView(); those behind the render time are dropped
+    static constexpr size_t kMaxTimeline = 64;
+    std::deque<game::Snap> m_timeline;
+    GameClientConfig m_cfg;
+    float m_tickDt{ 1.f / 60.f };
+    std::chrono::steady_clock::time_point m_epoch{};
+    double m_clockOffset{ 0.0 };    // host time minus local time, smoothed over snapshot arrivals
+    bool m_clockSynced{ false };
+
+    // Inputs sent but not yet in an authoritative snapshot, replayed on top of each new one
+    struct PendingInput {
+        uint32_t tick;
+        int8_t moveX;
+        int8_t moveY;
+    };
+    static constexpr size_t kMaxPending = 128;
+    static constexpr uint32_t kMaxCatchUpTicks = 5;
+    std::deque<PendingInput> m_pending;
+    game::PlayerState m_predicted{};
+    bool m_hasPrediction{ false };
+    double m_predAccum{ 0.0 };
+    float m_corrX{ 0.f }; // display offset easing out the last misprediction
+    float m_corrY{ 0.f };
 };
\ No newline at end of file
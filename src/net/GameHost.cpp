@@ -1,25 +1,36 @@
 #include "GameHost.hpp"
+#include "BitStream.hpp"
 #include <iostream>
 #include <cstring>
 #include <algorithm>
 
-static float clampf(float v, float lo, float hi) {
-    return (v < lo) ? lo : (v > hi) ? hi : v;
-}
-
-bool GameHost::start(ISteamNetworkingSockets* iface, uint16_t port, uint32_t worldSeed) {
+bool GameHost::start(ISteamNetworkingSockets* iface, uint16_t port, uint32_t worldSeed, const GameHostConfig& cfg) {
     m_iface = iface;
     m_port = port;
     m_worldSeed = worldSeed;
 
+    m_cfg = cfg;
+    m_cfg.tickHz = std::clamp<uint32_t>(m_cfg.tickHz, 10, 240);
+    m_cfg.snapEveryTicks = std::max<uint32_t>(m_cfg.snapEveryTicks, 1);
+    m_cfg.maxCatchUpTicks = std::max<uint32_t>(m_cfg.maxCatchUpTicks, 1);
+    m_tickDt = 1.f / (float)m_cfg.tickHz;
+    m_codec = game::SnapCodec(m_cfg.posScale);
+    m_history.fill(game::QuantSnap{});
+    m_snapSeq = 0;
+    m_tickAccum = 0.0;
+    m_ticksSinceSnap = 0;
+
     // init state (host is player 0)
     for (uint8_t i = 0; i < game::kMaxPlayers; ++i) {
         m_state[i].id = i;
         m_state[i].x = 200.f + 90.f * i;
         m_state[i].y = 200.f;
-        m_inputX[i] = 0;
-        m_inputY[i] = 0;
+        m_inputQueue[i].clear();
+        m_inputTick[i] = 0;
+        m_appliedInput[i] = 0;
     }
+    m_hostMoveX = 0;
+    m_hostMoveY = 0;
 
     SteamNetworkingIPAddr addr;
     addr.Clear();
@@ -37,7 +48,8 @@ bool GameHost::start(ISteamNetworkingSockets* iface, uint16_t port, uint32_t wor
         return false;
     }
 
-    std::cout << "[Host] Listening on port " << port << " (worldSeed=" << worldSeed << ")\n";
+    std::cout << "[Host] Listening on port " << port << " (worldSeed=" << worldSeed << ", " << m_cfg.tickHz
+        << " Hz tick, snapshot every " << m_cfg.snapEveryTicks << ")\n";
     return true;
 }
 
@@ -49,6 +61,7 @@ void GameHost::stop() {
     }
     m_clients.clear();
     m_connToId.clear();
+    m_links.clear();
 
     if (m_poll != k_HSteamNetPollGroup_Invalid) {
         m_iface->DestroyPollGroup(m_poll);
@@ -101,10 +114,14 @@ void GameHost::onConnStatusChanged(SteamNetConnectionStatusChangedCallback_t* in
 
         m_clients.push_back(conn);
         m_connToId[conn] = slot;
+        m_inputQueue[slot].clear();
+        m_inputTick[slot] = 0; // a new client counts its inputs from 1 again
+        m_appliedInput[slot] = 0;
+        m_links[conn].window.id = slot;
 
         sendWelcome(conn, slot);
-        // Push an immediate snapshot so the client sees something right away
-        sendSnap(conn, true);
+        // Push an immediate (full) snapshot so the client sees something right away
+        sendSnap(conn, takeSnapshot(), true);
 
         // If game already started, bring this late joiner in immediately.
         if (m_gameStarted) {
@@ -120,10 +137,12 @@ void GameHost::onConnStatusChanged(SteamNetConnectionStatusChangedCallback_t* in
         auto it = m_connToId.find(conn);
         if (it != m_connToId.end()) {
             uint8_t id = it->second;
-            m_inputX[id] = 0;
-            m_inputY[id] = 0;
+            m_inputQueue[id].clear();
+            m_inputTick[id] = 0;
+            m_appliedInput[id] = 0;
             m_connToId.erase(it);
         }
+        m_links.erase(conn);
         m_clients.erase(std::remove(m_clients.begin(), m_clients.end(), conn), m_clients.end());
         m_iface->CloseConnection(conn, 0, "cleanup", false);
         std::cout << "[Host] Client disconnected\n";
@@ -156,20 +175,79 @@ void GameHost::handleMessage(HSteamNetConnection from, const void* data, uint32_
         return;
     }
 
-    if (type == game::Type::Input) {
-        if (size < sizeof(game::Input)) return;
+    if (type == game::Type::InputBatch) {
+        onInputBatch(from, (const uint8_t*)data, size);
+        return;
+    }
 
-        auto it = m_connToId.find(from);
-        if (it == m_connToId.end()) return;
+    if (type == game::Type::SnapAck) {
+        if (size < sizeof(game::SnapAck)) return;
+        game::SnapAck ack{};
+        std::memcpy(&ack, data, sizeof(ack));
+        onSnapAck(from, ack);
+        return;
+    }
+}
 
-        const uint8_t assignedId = it->second;
-        const auto* in = (const game::Input*)data;
+void GameHost::onSnapAck(HSteamNetConnection from, const game::SnapAck& ack) {
+    auto it = m_links.find(from);
+    if (it == m_links.end()) return;
+    ClientLink& link = it->second;
+
+    // Each ack repeats the window before it, so a lost ack costs nothing
+    for (uint32_t k = 0; k < kSnapHistory; ++k) {
+        if (k > 0 && !(ack.earlier & (1u << (k - 1)))) continue;
+        SentSnap& s = link.sent[(ack.seq - k) % kSnapHistory];
+        if (!s.live || s.acked || s.seq != ack.seq - k) continue;
+        s.acked = true;
+        ++link.window.snapsAcked;
+    }
 
-        // Trust the connection->id mapping, not the packet's playerId
-        m_inputX[assignedId] = (int8_t)std::clamp<int>(in->moveX, -1, 1);
-        m_inputY[assignedId] = (int8_t)std::clamp<int>(in->moveY, -1, 1);
-        return;
+    // Only a newer snapshot we sent this client, still in the history, can become the baseline
+    if (link.hasBaseline && (int32_t)(ack.seq - link.baselineSeq) <= 0) return;
+    const SentSnap& s = link.sent[ack.seq % kSnapHistory];
+    if (!s.acked || s.seq != ack.seq) return;
+    if (m_history[ack.seq % kSnapHistory].seq != ack.seq) return;
+    link.baselineSeq = ack.seq;
+    link.hasBaseline = true;
+}
+
+void GameHost::onInputBatch(HSteamNetConnection from, const uint8_t* data, uint32_t size) {
+    if (size < sizeof(game::InputBatchHdr)) return;
+    auto it = m_connToId.find(from);
+    if (it == m_connToId.end()) return;
+    const uint8_t id = it->second;
+
+    game::InputBatchHdr hdr{};
+    std::memcpy(&hdr, data, sizeof(hdr));
+    if (hdr.count == 0 || hdr.count > game::kMaxInputBatch) return;
+
+    int8_t moves[game::kMaxInputBatch][2];
+    BitReader r(data + sizeof(hdr), size - sizeof(hdr));
+    for (uint8_t k = 0; k < hdr.count; ++k) {
+        const uint32_t mx = r.read(2);
+        const uint32_t my = r.read(2);
+        if (mx > 2 || my > 2) return;
+        moves[k][0] = (int8_t)((int)mx - 1);
+        moves[k][1] = (int8_t)((int)my - 1);
     }
+    if (!r.ok()) return;
+
+    // Oldest first, skipping what an earlier batch already queued; ticks older than the whole
+    // batch that never came are gone for good
+    auto& q = m_inputQueue[id];
+    for (int k = hdr.count - 1; k >= 0; --k) {
+        const uint32_t tick = hdr.newestTick - (uint32_t)k;
+        const int32_t ahead = (int32_t)(tick - m_inputTick[id]);
+        if (ahead <= 0) continue;
+        if (ahead > 1 && m_inputTick[id] != 0) {
+            auto link = m_links.find(from);
+            if (link != m_links.end()) link->second.window.inputsLost += (uint32_t)(ahead - 1);
+        }
+        q.push_back({ tick, moves[k][0], moves[k][1] });
+        m_inputTick[id] = tick;
+    }
+    while (q.size() > 2u * game::kMaxInputBatch) q.pop_front();
 }
 
 void GameHost::sendWelcome(HSteamNetConnection to, uint8_t assignedId) {
@@ -177,50 +255,122 @@ void GameHost::sendWelcome(HSteamNetConnection to, uint8_t assignedId) {
     w.type = game::Type::Welcome;
     w.yourId = assignedId;
     w.worldSeed = m_worldSeed;
+    w.posScale = m_codec.posScale();
+    w.tickHz = (uint16_t)m_cfg.tickHz;
 
-    m_iface->SendMessageToConnection(to, &w, sizeof(w), k_nSteamNetworkingSend_Reliable, nullptr);
+    sendTo(to, &w, sizeof(w), k_nSteamNetworkingSend_Reliable);
 }
 
-void GameHost::sendSnap(HSteamNetConnection to, bool reliable) {
-    game::Snap s{};
-    s.type = game::Type::Snap;
-    s.serverTick = m_serverTick;
-    s.count = game::kMaxPlayers;
+void GameHost::sendSnap(HSteamNetConnection to, const game::QuantSnap& cur, bool reliable) {
+    auto it = m_links.find(to);
+    if (it == m_links.end()) return;
+    ClientLink& link = it->second;
+
+    // Delta against the newest snapshot the client acked, while the history still has it (the
+    // reliable one on connect is always full)
+    const game::QuantSnap* base = nullptr;
+    const uint32_t age = cur.seq - link.baselineSeq;
+    if (!reliable && link.hasBaseline && age > 0 && age < kSnapHistory) {
+        const game::QuantSnap& b = m_history[link.baselineSeq % kSnapHistory];
+        if (b.seq == link.baselineSeq) base = &b;
+    }
+
+    game::SnapDeltaHdr hdr{};
+    hdr.type = game::Type::SnapDelta;
+    hdr.serverTick = cur.tick;
+    hdr.seq = cur.seq;
+    hdr.baseAge = base ? (uint8_t)age : 0;
+    hdr.inputAck = m_appliedInput[link.window.id];
+
+    std::vector<uint8_t> bytes(sizeof(hdr));
+    std::memcpy(bytes.data(), &hdr, sizeof(hdr));
+    m_codec.encode(bytes, cur, base);
 
-    for (uint8_t i = 0; i < game::kMaxPlayers; ++i) s.players[i] = m_state[i];
+    SentSnap& slot = link.sent[cur.seq % kSnapHistory];
+    if (slot.live && !slot.acked) ++link.window.snapsLost;
+    slot = SentSnap{ cur.seq, true, false };
+    if (base) ++link.window.deltaSnaps;
+    else ++link.window.fullSnaps;
 
     const int flags = reliable ? k_nSteamNetworkingSend_Reliable : k_nSteamNetworkingSend_Unreliable;
-    m_iface->SendMessageToConnection(to, &s, sizeof(s), flags, nullptr);
+    sendTo(to, bytes.data(), (uint32_t)bytes.size(), flags);
 }
 
 void GameHost::broadcastSnap() {
+    if (m_clients.empty()) return;
+
+    const game::QuantSnap& cur = takeSnapshot();
     for (auto c : m_clients) {
-        sendSnap(c, false);
+        sendSnap(c, cur, false);
     }
 }
 
-void GameHost::updateSim(float dt, int8_t hostMoveX, int8_t hostMoveY) {
+const game::QuantSnap& GameHost::takeSnapshot() {
+    game::QuantSnap& cur = m_history[++m_snapSeq % kSnapHistory];
+    m_codec.quantize(m_state, m_serverTick, cur);
+    cur.seq = m_snapSeq;
+    return cur;
+}
+
+void GameHost::sendTo(HSteamNetConnection to, const void* data, uint32_t size, int flags) {
+    auto it = m_links.find(to);
+    if (it != m_links.end()) it->second.window.bytes += size;
+    m_iface->SendMessageToConnection(to, data, size, flags, nullptr);
+}
+
+void GameHost::drainNetStats(std::vector<ClientNetStats>& out) {
+    for (auto& kv : m_links) {
+        out.push_back(kv.second.window);
+        kv.second.window = ClientNetStats{};
+        kv.second.window.id = out.back().id;
+    }
+}
+
+int GameHost::updateSim(float frameDt, int8_t hostMoveX, int8_t hostMoveY) {
     // host local input drives player 0
-    m_inputX[0] = (int8_t)std::clamp<int>(hostMoveX, -1, 1);
-    m_inputY[0] = (int8_t)std::clamp<int>(hostMoveY, -1, 1);
+    m_hostMoveX = (int8_t)std::clamp<int>(hostMoveX, -1, 1);
+    m_hostMoveY = (int8_t)std::clamp<int>(hostMoveY, -1, 1);
+
+    m_tickAccum += std::max(frameDt, 0.f);
+
+    // After a long stall (window drag, breakpoint) catch up a few ticks and drop the rest, rather
+    // than burning the next frames replaying it
+    const double maxAccum = (double)m_cfg.maxCatchUpTicks * m_tickDt;
+    if (m_tickAccum > maxAccum) {
+        const uint32_t skipped = (uint32_t)((m_tickAccum - maxAccum) / m_tickDt);
+        if (skipped > 0) std::cout << "[Host] Sim fell behind, skipped " << skipped << " ticks\n";
+        m_tickAccum = maxAccum;
+    }
 
-    const float speed = 240.f;
-    for (uint8_t i = 0; i < game::kMaxPlayers; ++i) {
-        m_state[i].x += (float)m_inputX[i] * speed * dt;
-        m_state[i].y += (float)m_inputY[i] * speed * dt;
+    int ticks = 0;
+    while (m_tickAccum >= m_tickDt) {
+        m_tickAccum -= m_tickDt;
+        tick();
+        ++ticks;
+    }
+    return ticks;
+}
 
-        // simple bounds for now (matches 1280x720 window)
-        m_state[i].x = clampf(m_state[i].x, 0.f, 1280.f);
-        m_state[i].y = clampf(m_state[i].y, 0.f, 720.f);
+void GameHost::tick() {
+    game::stepPlayer(m_state[0], m_hostMoveX, m_hostMoveY, m_tickDt);
+
+    // A client with nothing queued stands still: its input for this tick is late, not gone, and
+    // still moves it when it arrives, so host and prediction end up in the same place
+    for (uint8_t i = 1; i < game::kMaxPlayers; ++i) {
+        auto& q = m_inputQueue[i];
+        size_t n = std::min<size_t>(q.size(), 1);
+        if (q.size() > kMaxQueuedInputs) n = q.size() - kMaxQueuedInputs + 1;
+        for (; n > 0; --n) {
+            game::stepPlayer(m_state[i], q.front().moveX, q.front().moveY, m_tickDt);
+            m_appliedInput[i] = q.front().tick;
+            q.pop_front();
+        }
     }
 
     ++m_serverTick;
 
-    // Snapshot at 20 Hz
-    m_snapAccum += dt;
-    const float snapDt = 1.f / 80.f;
-    if (m_snapAccum >= snapDt) {
-        m_snapAccum -= snapDt;
+    if (++m_ticksSinceSnap >= m_cfg.snapEveryTicks) {
+        m_ticksSinceSnap = 0;
         broadcastSnap();
     }
 }
@@ -230,7 +380,7 @@ void GameHost::sendStartGame(HSteamNetConnection to) {
     m.type = game::Type::StartGame;
     m.worldSeed = m_worldSeed;
 
-    m_iface->SendMessageToConnection(to, &m, sizeof(m), k_nSteamNetworkingSend_Reliable, nullptr);
+    sendTo(to, &m, sizeof(m), k_nSteamNetworkingSend_Reliable);
 }
 
 void GameHost::restoreState(const game::PlayerState* states, uint32_t tick) {
@@ -1,5 +1,7 @@
 #pragma once
 #include <vector>
+#include <array>
+#include <deque>
 #include <unordered_map>
 #include <cstdint>
 
@@ -8,17 +10,31 @@
 #include <steam/steamnetworkingtypes.h>
 
 #include "GameProtocol.hpp"
+#include "SnapCodec.hpp"
+#include "PlayerMovement.hpp"
+
+struct GameHostConfig {
+    uint32_t tickHz{ 60 };          // simulation rate, independent of the render frame rate
+    uint32_t snapEveryTicks{ 3 };   // snapshot broadcast period (20 Hz; clients interpolate)
+    uint32_t maxCatchUpTicks{ 5 };  // per updateSim(); a longer stall is skipped, not replayed
+    uint16_t posScale{ game::SnapCodec::kDefaultPosScale }; // snapshot position steps per pixel
+};
 
 class GameHost {
 public:
-    bool start(ISteamNetworkingSockets* iface, uint16_t port, uint32_t worldSeed);
+    bool start(ISteamNetworkingSockets* iface, uint16_t port, uint32_t worldSeed, const GameHostConfig& cfg = {});
     void stop();
 
     void onConnStatusChanged(SteamNetConnectionStatusChangedCallback_t* info);
     void pumpNetwork();
 
-    // Call each frame: applies stored inputs and moves players, broadcasts snapshots at fixed rate.
-    void updateSim(float dt, int8_t hostMoveX, int8_t hostMoveY);
+    // Call each frame with the real time elapsed: runs the fixed ticks that came due (latest
+    // inputs, fixed dt), broadcasting a snapshot every snapEveryTicks. Returns ticks run.
+    int updateSim(float frameDt, int8_t hostMoveX, int8_t hostMoveY);
+
+    uint32_t serverTick() const { return m_serverTick; }
+    float tickDt() const { return m_tickDt; }
+    float timeToNextTick() const { return m_tickDt - (float)m_tickAccum; } // of real time, from the last updateSim()
 
     uint16_t port() const { return m_port; }
     HSteamListenSocket listenSocket() const { return m_listen; }
@@ -34,13 +50,29 @@ public:
 
     void restoreState(const game::PlayerState* states, uint32_t tick);
 
+    // What each connected client was sent since the last drain
+    struct ClientNetStats {
+        uint8_t id;
+        uint64_t bytes;       // everything sent to it, payload only
+        uint32_t fullSnaps;
+        uint32_t deltaSnaps;
+        uint32_t snapsAcked;  // snapshots it confirmed
+        uint32_t snapsLost;   // left the ack window unconfirmed
+        uint32_t inputsLost;  // ticks whose input never arrived, not even repeated in a later batch
+    };
+    void drainNetStats(std::vector<ClientNetStats>& out);
+
 private:
     void handleMessage(HSteamNetConnection from, const void* data, uint32_t size);
     void sendWelcome(HSteamNetConnection to, uint8_t assignedId);
-    void sendSnap(HSteamNetConnection to, bool reliable);
+    void sendSnap(HSteamNetConnection to, const game::QuantSnap& cur, bool reliable);
     void broadcastSnap();
+    const game::QuantSnap& takeSnapshot(); // the current state as the next snapshot, in m_history
     void sendStartGame(HSteamNetConnection to);
-    
+    void sendTo(HSteamNetConnection to, const void* data, uint32_t size, int flags); // counts bytes
+    void onSnapAck(HSteamNetConnection from, const game::SnapAck& ack);
+    void onInputBatch(HSteamNetConnection from, const uint8_t* data, uint32_t size);
+    void tick();
 
     uint8_t pickFreeClientSlot() const;
 
@@ -54,14 +86,51 @@ private:
     std::vector<HSteamNetConnection> m_clients; // up to 2
     std::unordered_map<HSteamNetConnection, uint8_t> m_connToId;
 
+    // The last kSnapHistory snapshots taken, slot seq % kSnapHistory; any of them can be a
+    // baseline. Counted in snapshots, so the depth doesn't shrink as snapEveryTicks grows.
+    static constexpr uint32_t kSnapHistory = 32;
+    std::array<game::QuantSnap, kSnapHistory> m_history{};
+    uint32_t m_snapSeq{ 0 }; // of the newest; the first is 1
+
+    // Per client: which of those it was sent and has acked, and the newest acked one, which the
+    // next snapshot is a delta against. A send that finds its slot still unacked counts a loss.
+    struct SentSnap {
+        uint32_t seq{ 0 };
+        bool live{ false };
+        bool acked{ false };
+    };
+    struct ClientLink {
+        std::array<SentSnap, kSnapHistory> sent{};
+        uint32_t baselineSeq{ 0 };
+        bool hasBaseline{ false };
+        ClientNetStats window{};
+    };
+    std::unordered_map<HSteamNetConnection, ClientLink> m_links;
+    game::SnapCodec m_codec;
+
     uint32_t m_worldSeed{ 0 };
     bool m_gameStarted{ false }; // NEW
 
     // authoritative sim state
     game::PlayerState m_state[game::kMaxPlayers]{};
-    int8_t m_inputX[game::kMaxPlayers]{};
-    int8_t m_inputY[game::kMaxPlayers]{};
-
+    int8_t m_hostMoveX{ 0 };
+    int8_t m_hostMoveY{ 0 };
+
+    // Client slots: inputs received but not simulated yet, oldest first, one applied per tick the
+    // way the client predicted them. A backlog past kMaxQueuedInputs is worked off at once.
+    struct QueuedInput {
+        uint32_t tick;
+        int8_t moveX;
+        int8_t moveY;
+    };
+    static constexpr size_t kMaxQueuedInputs = 4;
+    std::deque<QueuedInput> m_inputQueue[game::kMaxPlayers];
+    uint32_t m_inputTick[game::kMaxPlayers]{};    // newest clientTick queued
+    uint32_t m_appliedInput[game::kMaxPlayers]{}; // newest clientTick simulated, echoed in snapshots
+
+    GameHostConfig m_cfg;
+    float m_tickDt{ 1.f / 60.f };
+    double m_tickAccum{ 0.0 };   // real time not yet simulated, < m_tickDt between calls
     uint32_t m_serverTick{ 0 };
-    float m_snapAccum{ 0.f };
+    uint32_t m_ticksSinceSnap{ 0 };
 };
\ No newline at end of file
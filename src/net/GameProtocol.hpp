@@ -3,15 +3,23 @@
 
 namespace game {
 
-    static constexpr uint32_t kProtocol = 1;
+    static constexpr uint32_t kProtocol = 7; // 2: quantized delta snapshots, 3: SnapAck received mask, 4: Welcome tickHz, 5: inputAck, 6: InputBatch, 7: snapshot seq
     static constexpr uint8_t  kMaxPlayers = 3;
+    static constexpr uint8_t  kMaxInputBatch = 32; // inputs per InputBatch
+
+    // Player positions are clamped to this (matches the 1280x720 window for now)
+    static constexpr float kWorldWidth = 1280.f;
+    static constexpr float kWorldHeight = 720.f;
 
     enum class Type : uint8_t {
         Hello = 1,
         Welcome = 2,
-        Input = 3,
+        Input = 3,     // single input, before protocol 6
         Snap = 4,
         StartGame = 5, // NEW
+        SnapDelta = 6, // host -> client (replaces Snap on the wire)
+        SnapAck = 7,   // client -> host: snapshots decoded
+        InputBatch = 8, // client -> host: recent inputs (replaces Input)
     };
 
 #pragma pack(push, 1)
@@ -25,6 +33,8 @@ namespace game {
         Type     type;        // Welcome
         uint8_t  yourId;      // 0..2
         uint32_t worldSeed;   // for roguelike determinism later
+        uint16_t posScale;    // snapshot position steps per pixel
+        uint16_t tickHz;      // host sim rate: how snapshot ticks map to time
     };
 
     // NEW: host -> clients (reliable)
@@ -33,12 +43,13 @@ namespace game {
         uint32_t worldSeed;  // seed to use for the run
     };
 
-    struct Input {
-        Type     type;        // Input
-        uint32_t clientTick;
-        uint8_t  playerId;    // client-supplied; host will sanity-check mapping anyway
-        int8_t   moveX;       // -1,0,1
-        int8_t   moveY;       // -1,0,1
+    // Unreliable, one per client tick: this header, then the inputs of ticks newestTick,
+    // newestTick - 1, ... (count of them) bit-packed as moveX + 1, moveY + 1 in 2 bits each. The
+    // repeats let the host fill in what a lost packet carried from the next one.
+    struct InputBatchHdr {
+        Type     type;        // InputBatch
+        uint32_t newestTick;  // clientTick of the first input
+        uint8_t  count;       // 1..kMaxInputBatch
     };
 
     struct PlayerState {
@@ -47,6 +58,7 @@ namespace game {
         float   y;
     };
 
+    // A decoded snapshot (GameClient::popLatestSnap); protocol 1 sent it as is
     struct Snap {
         Type        type;        // Snap
         uint32_t    serverTick;
@@ -54,6 +66,23 @@ namespace game {
         PlayerState players[kMaxPlayers];
     };
 
+    // Snapshot on the wire: this header, then the positions bit-packed by SnapCodec. Snapshots are
+    // numbered by seq, one apart however many ticks lie between them. baseAge 0 is the full state,
+    // otherwise a delta against snapshot seq - baseAge, which the client acked.
+    struct SnapDeltaHdr {
+        Type     type;        // SnapDelta
+        uint32_t serverTick;
+        uint32_t seq;
+        uint8_t  baseAge;
+        uint32_t inputAck;    // newest Input.clientTick of the recipient's that this state includes
+    };
+
+    struct SnapAck {
+        Type     type;        // SnapAck
+        uint32_t seq;         // newest snapshot the client has decoded
+        uint32_t earlier;     // bit k-1 set: snapshot seq - k was decoded too
+    };
+
 #pragma pack(pop)
 
 } // namespace game
@@ -0,0 +1,74 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+// Log-linear histogram of microsecond samples (16 sub-buckets per power of two,
+// so any reported percentile is within ~6% of the true value). Fixed size, no allocation.
+class LatencyHistogram {
+public:
+    void record(int64_t usec) {
+        const uint64_t v = (usec < 0) ? 0 : (uint64_t)usec;
+        ++m_buckets[bucketOf(v)];
+        ++m_count;
+        if (v > m_max) m_max = v;
+    }
+
+    // p in [0,1]. Returns the upper bound of the bucket holding that rank (0 if empty).
+    uint64_t percentile(double p) const {
+        if (m_count == 0) return 0;
+        uint64_t rank = (uint64_t)(p * (double)m_count);
+        if (rank >= m_count) rank = m_count - 1;
+
+        uint64_t seen = 0;
+        for (size_t i = 0; i < m_buckets.size(); ++i) {
+            seen += m_buckets[i];
+            if (seen > rank) {
+                const uint64_t hi = bucketUpper(i);
+                return (hi < m_max) ? hi : m_max;
+            }
+        }
+        return m_max;
+    }
+
+    uint64_t count() const { return m_count; }
+    uint64_t max() const { return m_max; }
+
+    void merge(const LatencyHistogram& o) {
+        for (size_t i = 0; i < m_buckets.size(); ++i) m_buckets[i] += o.m_buckets[i];
+        m_count += o.m_count;
+        if (o.m_max > m_max) m_max = o.m_max;
+    }
+
+    void reset() {
+        m_buckets.fill(0);
+        m_count = 0;
+        m_max = 0;
+    }
+
+private:
+    static constexpr int kSubBits = 4;
+    static constexpr uint64_t kSub = 1ull << kSubBits;
+
+    static int msb(uint64_t v) {
+        int n = 0;
+        while (v >>= 1) ++n;
+        return n;
+    }
+
+    static size_t bucketOf(uint64_t v) {
+        if (v < kSub) return (size_t)v;
+        const int shift = msb(v) - kSubBits;
+        return (size_t)((uint64_t)(shift + 1) * kSub + ((v >> shift) & (kSub - 1)));
+    }
+
+    static uint64_t bucketUpper(size_t idx) {
+        if (idx < kSub) return idx;
+        const int shift = (int)(idx / kSub) - 1;
+        const uint64_t base = (kSub + (idx % kSub)) << shift;
+        return base + ((1ull << shift) - 1);
+    }
+
+    std::array<uint64_t, (64 - kSubBits + 1) * kSub> m_buckets{};
+    uint64_t m_count{ 0 };
+    uint64_t m_max{ 0 };
+};
\ No newline at end of file
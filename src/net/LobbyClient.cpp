@@ -1,17 +1,26 @@
 #include "LobbyClient.hpp"
 #include <iostream>
 #include <cstring>
+#include <cstddef>
 #include <random>
 #include <algorithm>
 
 bool LobbyClient::connect(ISteamNetworkingSockets* iface, const std::string& lobbyAddr, Role role) {
     m_iface = iface;
     m_role = role;
+    m_lobbyAddr = lobbyAddr;
+    m_reconnectPending = false;
+    resetList();
+    m_addrs6.clear();
 
+    return openConnection();
+}
+
+bool LobbyClient::openConnection() {
     SteamNetworkingIPAddr addr;
     addr.Clear();
-    if (!addr.ParseString(lobbyAddr.c_str())) {
-        std::cerr << "[LobbyClient] Bad lobby address: " << lobbyAddr << "\n";
+    if (!addr.ParseString(m_lobbyAddr.c_str())) {
+        std::cerr << "[LobbyClient] Bad lobby address: " << m_lobbyAddr << "\n";
         return false;
     }
 
@@ -32,8 +41,20 @@ void LobbyClient::disconnect(const char* reason) {
     }
 
     m_connected = false;
+    m_reconnectPending = false;
+    m_wantSubscribe = false;
+    m_hasPage = false;
+    m_page.clear();
+    m_hasQuickMatch = false;
+    m_hasStats = false;
+    resetList();
+}
+
+void LobbyClient::resetList() {
     m_hasList = false;
     m_latestList.clear();
+    m_listEpoch = 0;
+    m_listVersion = 0;
 }
 
 void LobbyClient::onConnStatusChanged(SteamNetConnectionStatusChangedCallback_t* info) {
@@ -55,6 +76,9 @@ void LobbyClient::onConnStatusChanged(SteamNetConnectionStatusChangedCallback_t*
         if (m_role == Role::Announcer && m_hasAnnounce) {
             sendAnnounceNow();
         }
+        if (m_wantSubscribe) {
+            sendListReq(lobby::Type::Subscribe);
+        }
         return;
     }
 
@@ -65,12 +89,26 @@ void LobbyClient::onConnStatusChanged(SteamNetConnectionStatusChangedCallback_t*
             m_iface->CloseConnection(m_conn, 0, "cleanup", false);
             m_conn = k_HSteamNetConnection_Invalid;
         }
+
+        if (m_role == Role::Announcer && m_hasAnnounce) {
+            m_reconnectPending = true;
+            m_reconnectAt = std::chrono::steady_clock::now() + kReconnectDelay;
+        }
         return;
     }
 }
 
 void LobbyClient::pump() {
     if (!m_iface) return;
+
+    if (m_reconnectPending && std::chrono::steady_clock::now() >= m_reconnectAt) {
+        // Connected re-sends the announce; a failed attempt closes and lands back here
+        m_reconnectPending = false;
+        if (!openConnection()) {
+            m_reconnectPending = true;
+            m_reconnectAt = std::chrono::steady_clock::now() + kReconnectDelay;
+        }
+    }
     if (m_conn == k_HSteamNetConnection_Invalid) return;
 
     SteamNetworkingMessage_t* msgs[32];
@@ -87,10 +125,31 @@ void LobbyClient::pump() {
 
 void LobbyClient::requestList() {
     if (!m_connected) return;
+    sendListReq(lobby::Type::ListReq);
+}
+
+void LobbyClient::subscribe() {
+    m_wantSubscribe = true;
+    if (!m_connected) return; // sent on Connected
+    sendListReq(lobby::Type::Subscribe);
+}
 
+void LobbyClient::unsubscribe() {
+    if (!m_wantSubscribe) return;
+    m_wantSubscribe = false;
+    if (!m_connected) return;
+
+    lobby::Unsubscribe u{};
+    u.type = lobby::Type::Unsubscribe;
+    m_iface->SendMessageToConnection(m_conn, &u, sizeof(u), k_nSteamNetworkingSend_Reliable, nullptr);
+}
+
+void LobbyClient::sendListReq(lobby::Type type) {
     lobby::ListReq r{};
-    r.type = lobby::Type::ListReq;
+    r.type = type;
     r.protocol = lobby::kProtocol;
+    r.listEpoch = m_listEpoch;
+    r.listVersion = m_listVersion;
 
     m_iface->SendMessageToConnection(m_conn, &r, sizeof(r), k_nSteamNetworkingSend_Reliable, nullptr);
 }
@@ -102,6 +161,81 @@ bool LobbyClient::popLatestList(std::vector<lobby::SessionEntry>& out) {
     return true;
 }
 
+void LobbyClient::requestPage(const PageQuery& q, uint64_t cursor) {
+    if (!m_connected) return;
+
+    lobby::ListReq r{};
+    r.type = lobby::Type::ListReq;
+    r.protocol = lobby::kProtocol;
+    r.pageSize = (uint8_t)std::clamp<int>(q.pageSize, 1, lobby::kMaxPageEntries);
+    r.filterFlags = q.filterFlags;
+    r.minFreeSlots = q.minFreeSlots;
+    r.worldSeed = q.worldSeed;
+    r.cursor = cursor;
+    std::memcpy(r.namePrefix, q.namePrefix.data(), std::min(q.namePrefix.size(), sizeof(r.namePrefix))); // not terminated at 16 chars
+
+    m_iface->SendMessageToConnection(m_conn, &r, sizeof(r), k_nSteamNetworkingSend_Reliable, nullptr);
+}
+
+bool LobbyClient::popPage(std::vector<lobby::SessionEntry>& out, uint64_t& nextCursor) {
+    if (!m_hasPage) return false;
+    out = m_page;
+    nextCursor = m_pageCursor;
+    m_hasPage = false;
+    return true;
+}
+
+void LobbyClient::requestQuickMatch(bool reserveSlot) {
+    if (!m_connected) return;
+
+    lobby::QuickMatch q{};
+    q.type = lobby::Type::QuickMatch;
+    q.protocol = lobby::kProtocol;
+    q.reserveSlot = reserveSlot ? 1 : 0;
+
+    m_iface->SendMessageToConnection(m_conn, &q, sizeof(q), k_nSteamNetworkingSend_Reliable, nullptr);
+}
+
+bool LobbyClient::popQuickMatch(bool& found, lobby::SessionEntry& out) {
+    if (!m_hasQuickMatch) return false;
+    found = m_quickMatch.found != 0;
+    if (found) out = m_quickMatch.entry;
+    m_hasQuickMatch = false;
+    return true;
+}
+
+bool LobbyClient::hostAddress(const lobby::SessionEntry& e, SteamNetworkingIPAddr& out) const {
+    out.Clear();
+    if (e.addrFamily == lobby::AddrIPv4) {
+        if (e.ipv4_host_order == 0) return false;
+        out.SetIPv4(e.ipv4_host_order, e.gamePort);
+        return true;
+    }
+    if (e.addrFamily != lobby::AddrIPv6) return false;
+
+    auto it = m_addrs6.find(e.sessionKey);
+    if (it == m_addrs6.end()) return false;
+    out.SetIPv6(it->second.data(), e.gamePort);
+    return true;
+}
+
+void LobbyClient::requestStats() {
+    if (!m_connected) return;
+
+    lobby::StatsReq q{};
+    q.type = lobby::Type::StatsReq;
+    q.protocol = lobby::kProtocol;
+
+    m_iface->SendMessageToConnection(m_conn, &q, sizeof(q), k_nSteamNetworkingSend_Reliable, nullptr);
+}
+
+bool LobbyClient::popStats(lobby::StatsResp& out) {
+    if (!m_hasStats) return false;
+    out = m_stats;
+    m_hasStats = false;
+    return true;
+}
+
 uint64_t LobbyClient::genSessionKey() {
     static std::mt19937_64 rng{ std::random_device{}() };
     uint64_t k = 0;
@@ -175,24 +309,111 @@ void LobbyClient::handleMessage(const void* data, uint32_t size) {
     const auto type = *(const lobby::Type*)data;
 
     if (type == lobby::Type::ListResp) {
-        if (size < sizeof(lobby::ListRespHdr)) return;
+        applyListResp((const uint8_t*)data, size);
+        return;
+    }
+
+    if (type == lobby::Type::QuickMatchResp) {
+        if (size < sizeof(lobby::QuickMatchResp)) return;
+        const uint8_t* p = (const uint8_t*)data;
+        lobby::QuickMatchResp resp{};
+        std::memcpy(&resp, p, sizeof(resp));
+        const uint8_t* entry = p + offsetof(lobby::QuickMatchResp, entry);
+        if (!readAddrs6(entry, resp.found ? 1 : 0, p + sizeof(resp), size - sizeof(resp))) return;
+        m_quickMatch = resp;
+        m_hasQuickMatch = true;
+        return;
+    }
 
-        lobby::ListRespHdr hdr{};
-        std::memcpy(&hdr, data, sizeof(hdr));
+    if (type == lobby::Type::StatsResp) {
+        if (size < sizeof(lobby::StatsResp)) return;
+        std::memcpy(&m_stats, data, sizeof(m_stats));
+        m_hasStats = true;
+        return;
+    }
 
-        const size_t expect = sizeof(lobby::ListRespHdr) + (size_t)hdr.count * sizeof(lobby::SessionEntry);
-        if (size < expect) return;
+    // ignore everything else for now
+}
 
+bool LobbyClient::readAddrs6(const uint8_t* entries, uint16_t count, const uint8_t* addrs, size_t addrBytes) {
+    // One SessionAddr6 per AddrIPv6 entry, in entry order
+    size_t want = 0;
+    for (uint16_t i = 0; i < count; ++i) {
+        if (entries[(size_t)i * sizeof(lobby::SessionEntry) + offsetof(lobby::SessionEntry, addrFamily)] == lobby::AddrIPv6) ++want;
+    }
+    if (addrBytes < want * sizeof(lobby::SessionAddr6)) return false;
+
+    for (size_t i = 0; i < want; ++i) {
+        lobby::SessionAddr6 a{};
+        std::memcpy(&a, addrs + i * sizeof(a), sizeof(a));
+        std::memcpy(m_addrs6[a.sessionKey].data(), a.ipv6, sizeof(a.ipv6));
+    }
+    return true;
+}
+
+void LobbyClient::applyListResp(const uint8_t* data, uint32_t size) {
+    if (size < sizeof(lobby::ListRespHdr)) return;
+
+    lobby::ListRespHdr hdr{};
+    std::memcpy(&hdr, data, sizeof(hdr));
+
+    const size_t entryBytes = (size_t)hdr.count * sizeof(lobby::SessionEntry);
+    const size_t removedBytes = (size_t)hdr.removedCount * sizeof(uint64_t);
+    const size_t fixedBytes = sizeof(lobby::ListRespHdr) + entryBytes + removedBytes;
+    if (size < fixedBytes) return;
+
+    const uint8_t* entries = data + sizeof(lobby::ListRespHdr);
+    if (!readAddrs6(entries, hdr.count, data + fixedBytes, size - fixedBytes)) return;
+    ++m_listResponses;
+
+    if (hdr.kind == lobby::ListKind::Page) {
+        m_page.resize(hdr.count);
+        if (hdr.count) std::memcpy(m_page.data(), entries, entryBytes);
+        m_pageCursor = hdr.nextCursor;
+        m_hasPage = true;
+        return;
+    }
+
+    if (hdr.kind == lobby::ListKind::Full) {
         m_latestList.resize(hdr.count);
-        if (hdr.count) {
-            std::memcpy(m_latestList.data(),
-                (const uint8_t*)data + sizeof(lobby::ListRespHdr),
-                (size_t)hdr.count * sizeof(lobby::SessionEntry));
-        }
+        if (hdr.count) std::memcpy(m_latestList.data(), entries, entryBytes);
 
+        m_listEpoch = hdr.listEpoch;
+        m_listVersion = hdr.listVersion;
         m_hasList = true;
         return;
     }
 
-    // ignore everything else for now
+    // Delta/Unchanged only make sense against what we hold. Responses arrive in request order and
+    // deltas carry current entries, so re-applying one from an older base is harmless.
+    if (hdr.listEpoch != m_listEpoch || hdr.baseVersion > m_listVersion) {
+        resetList(); // next request gets a Full list
+        return;
+    }
+    if (hdr.listVersion <= m_listVersion) return;
+
+    if (hdr.kind == lobby::ListKind::Delta) {
+        for (uint16_t i = 0; i < hdr.count; ++i) {
+            lobby::SessionEntry e{};
+            std::memcpy(&e, entries + (size_t)i * sizeof(e), sizeof(e));
+
+            auto it = std::find_if(m_latestList.begin(), m_latestList.end(),
+                [&](const lobby::SessionEntry& x) { return x.sessionKey == e.sessionKey; });
+            if (it != m_latestList.end()) *it = e;
+            else m_latestList.push_back(e);
+        }
+
+        const uint8_t* removed = entries + entryBytes;
+        for (uint16_t i = 0; i < hdr.removedCount; ++i) {
+            uint64_t key{};
+            std::memcpy(&key, removed + (size_t)i * sizeof(key), sizeof(key));
+            m_latestList.erase(std::remove_if(m_latestList.begin(), m_latestList.end(),
+                [&](const lobby::SessionEntry& x) { return x.sessionKey == key; }), m_latestList.end());
+            m_addrs6.erase(key);
+        }
+
+        m_hasList = true;
+    }
+
+    m_listVersion = hdr.listVersion;
 }
\ No newline at end of file
@@ -1,7 +1,10 @@
 #pragma once
 #include <vector>
 #include <string>
+#include <array>
+#include <unordered_map>
 #include <cstdint>
+#include <chrono>
 
 #include <steam/steamnetworkingsockets.h>
 #include <steam/isteamnetworkingsockets.h>
@@ -21,13 +24,38 @@ public:
     void pump();
 
     bool isConnected() const { return m_connected; }
+    uint32_t listResponses() const { return m_listResponses; } // every ListResp applied, incl. Unchanged
     HSteamNetConnection conn() const { return m_conn; }
     Role role() const { return m_role; }
 
     // Browser flow
     void requestList();
+    void subscribe();   // lobby pushes list changes from now on (re-sent automatically once connected)
+    void unsubscribe();
     bool popLatestList(std::vector<lobby::SessionEntry>& out);
 
+    // Paged, server-filtered browsing (independent of the versioned list above)
+    struct PageQuery {
+        uint8_t filterFlags{ 0 };   // lobby::ListFilter bits
+        uint8_t minFreeSlots{ 0 };
+        uint32_t worldSeed{ 0 };
+        std::string namePrefix;     // up to 16 chars
+        uint8_t pageSize{ lobby::kMaxPageEntries };
+    };
+    void requestPage(const PageQuery& q, uint64_t cursor = 0);
+    bool popPage(std::vector<lobby::SessionEntry>& out, uint64_t& nextCursor); // nextCursor 0 = last page
+
+    // Let the lobby pick a session to join (optionally holding a slot for a few seconds)
+    void requestQuickMatch(bool reserveSlot = true);
+    bool popQuickMatch(bool& found, lobby::SessionEntry& out);
+
+    // Game address of a session from any list, page or QuickMatch answer (IPv4 or IPv6 host)
+    bool hostAddress(const lobby::SessionEntry& e, SteamNetworkingIPAddr& out) const;
+
+    // Lobby health report (last complete stats window)
+    void requestStats();
+    bool popStats(lobby::StatsResp& out);
+
     // Host announce flow (backward compatible overload auto-generates sessionKey)
     void setAnnounceInfo(uint16_t gamePort, uint8_t maxPlayers, uint32_t worldSeed, const std::string& name);
     void setAnnounceInfo(uint64_t sessionKey, uint16_t gamePort, uint8_t maxPlayers, uint32_t worldSeed, const std::string& name);
@@ -41,11 +69,23 @@ public:
 
 private:
     void handleMessage(const void* data, uint32_t size);
+    bool openConnection();
+    void applyListResp(const uint8_t* data, uint32_t size);
+    bool readAddrs6(const uint8_t* entries, uint16_t count, const uint8_t* addrs, size_t addrBytes);
+    void resetList();
+    void sendListReq(lobby::Type type);
     uint64_t genSessionKey();
 
 private:
     ISteamNetworkingSockets* m_iface{ nullptr };
     Role m_role{ Role::Browser };
+    std::string m_lobbyAddr;
+
+    // Announcers reconnect (and re-announce) on their own if the lobby drops them, e.g. a lobby
+    // restart; the restarted lobby keeps their session listed meanwhile
+    bool m_reconnectPending{ false };
+    std::chrono::steady_clock::time_point m_reconnectAt{};
+    static constexpr std::chrono::seconds kReconnectDelay{ 2 };
 
     HSteamNetConnection m_conn{ k_HSteamNetConnection_Invalid };
     bool m_connected{ false };
@@ -53,6 +93,26 @@ private:
     bool m_hasList{ false };
     std::vector<lobby::SessionEntry> m_latestList{};
 
+    bool m_hasPage{ false };
+    std::vector<lobby::SessionEntry> m_page{};
+    uint64_t m_pageCursor{ 0 };
+
+    // sessionKey -> address of every AddrIPv6 session we were sent (entries only carry IPv4)
+    std::unordered_map<uint64_t, std::array<uint8_t, 16>> m_addrs6;
+
+    bool m_hasQuickMatch{ false };
+    lobby::QuickMatchResp m_quickMatch{};
+
+    bool m_hasStats{ false };
+    lobby::StatsResp m_stats{};
+
+    // Which lobby list version m_latestList reflects; sent with ListReq so the lobby can answer
+    // Unchanged or with a delta instead of the full list
+    uint32_t m_listEpoch{ 0 };
+    uint32_t m_listVersion{ 0 };
+    uint32_t m_listResponses{ 0 };
+    bool m_wantSubscribe{ false };
+
     lobby::Announce m_announce{};
     bool m_hasAnnounce{ false };
     uint64_t m_sessionKey{ 0 };
@@ -0,0 +1,82 @@
+#include "LobbyLoop.hpp"
+#include <iostream>
+#include <algorithm>
+#include <thread>
+
+LobbyLoop::LobbyLoop(NetRuntime& rt, LobbyServer& lobby, const LobbyLoopConfig& cfg)
+    : m_rt(rt), m_lobby(lobby), m_cfg(cfg) {
+    m_nextStats = LobbyServer::Clock::now() + m_cfg.statsInterval;
+}
+
+void LobbyLoop::runOnce() {
+    using namespace std::chrono;
+
+    if (m_cfg.fixedSleep.count() > 0) {
+        m_rt.pumpCallbacks();
+        m_lobby.pump();
+        std::this_thread::sleep_for(m_cfg.fixedSleep);
+        maybeReportStats(LobbyServer::Clock::now());
+        return;
+    }
+
+    const auto now = LobbyServer::Clock::now();
+
+    auto wake = now + m_cfg.maxWait;
+    if (m_lobby.nextDeadline() < wake) wake = m_lobby.nextDeadline();
+    if (m_cfg.statsInterval.count() > 0 && m_nextStats < wake) wake = m_nextStats;
+
+    // Round up: expiry checks are strict '>' so waking a hair early would just spin
+    const auto waitMs = duration_cast<milliseconds>(wake - now).count() + 1;
+    m_rt.pollSockets((int)std::clamp<long long>(waitMs, 0, m_cfg.maxWait.count()));
+
+    m_rt.pumpCallbacks();
+    m_lobby.pump();
+
+    maybeReportStats(LobbyServer::Clock::now());
+}
+
+void LobbyLoop::run() {
+    for (;;) runOnce();
+}
+
+void LobbyLoop::maybeReportStats(LobbyServer::Clock::time_point now) {
+    if (m_cfg.statsInterval.count() <= 0 || now < m_nextStats) return;
+    m_nextStats = now + m_cfg.statsInterval;
+
+    LatencyHistogram h;
+    m_lobby.drainListLatency(h);
+    if (h.count() > 0) {
+        std::cout << "[Lobby] list latency n=" << h.count()
+            << " p50=" << h.percentile(0.50) << "us"
+            << " p99=" << h.percentile(0.99) << "us"
+            << " max=" << h.max() << "us"
+            << (m_cfg.fixedSleep.count() > 0 ? " (fixed-sleep loop)" : "") << "\n";
+    }
+
+    const lobby::StatsResp r = m_lobby.statsReport();
+    if (r.windowMs == 0) return;
+
+    const double secs = r.windowMs / 1000.0;
+    auto rate = [&](lobby::Type t) { return (uint32_t)(r.messages[(size_t)t] / secs + 0.5); };
+
+    std::cout << "[Lobby] sessions open=" << r.sessionsOpen << " full=" << r.sessionsFull
+        << " migrating=" << r.sessionsMigrating << " conns=" << r.connections << " subs=" << r.subscribers << "\n";
+    std::cout << "[Lobby] msgs/s announce=" << rate(lobby::Type::Announce) << " hb=" << rate(lobby::Type::Heartbeat)
+        << " list=" << rate(lobby::Type::ListReq) << " claim=" << rate(lobby::Type::Claim)
+        << " quick=" << rate(lobby::Type::QuickMatch)
+        << " | listResp/s=" << (uint32_t)(r.listResponses / secs + 0.5)
+        << " bytes p50=" << r.listBytesP50 << " p99=" << r.listBytesP99 << "\n";
+    std::cout << "[Lobby] pump p50=" << r.pumpP50Us << "us p99=" << r.pumpP99Us << "us max=" << r.pumpMaxUs << "us"
+        << " cleanup p99=" << r.cleanupP99Us << "us max=" << r.cleanupMaxUs << "us"
+        << " (last " << r.windowMs / 1000 << "s)\n";
+
+    uint64_t dropped = 0;
+    for (uint32_t d : r.dropped) dropped += d;
+    if (dropped > 0) {
+        auto drops = [&](lobby::Type t) { return r.dropped[(size_t)t]; };
+        std::cout << "[Lobby] rate-limited " << dropped << " msgs: list=" << drops(lobby::Type::ListReq)
+            << " subscribe=" << drops(lobby::Type::Subscribe) + drops(lobby::Type::Unsubscribe)
+            << " announce=" << drops(lobby::Type::Announce) << " claim=" << drops(lobby::Type::Claim)
+            << " hb=" << drops(lobby::Type::Heartbeat) << " quick=" << drops(lobby::Type::QuickMatch) << "\n";
+    }
+}
\ No newline at end of file
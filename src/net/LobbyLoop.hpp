@@ -0,0 +1,36 @@
+#pragma once
+#include <chrono>
+
+#include "NetCommon.hpp"
+#include "LobbyServer.hpp"
+
+struct LobbyLoopConfig {
+    // > 0: old behaviour (pump, then sleep this long). Kept for latency comparisons.
+    std::chrono::milliseconds fixedSleep{ 0 };
+
+    // Upper bound on a single blocking wait, so GNS housekeeping never starves
+    std::chrono::milliseconds maxWait{ 1000 };
+
+    // How often to log ListReq->ListResp latency and the latest lobby health report (0 = never)
+    std::chrono::seconds statsInterval{ 60 };
+};
+
+// Drives a dedicated LobbyServer: blocks on the sockets until a message arrives
+// or the next session TTL/grace deadline is due, then pumps.
+class LobbyLoop {
+public:
+    LobbyLoop(NetRuntime& rt, LobbyServer& lobby, const LobbyLoopConfig& cfg = {});
+
+    void runOnce();
+    void run(); // never returns
+
+private:
+    void maybeReportStats(LobbyServer::Clock::time_point now);
+
+private:
+    NetRuntime& m_rt;
+    LobbyServer& m_lobby;
+    LobbyLoopConfig m_cfg;
+
+    LobbyServer::Clock::time_point m_nextStats{};
+};
\ No newline at end of file
@@ -0,0 +1,370 @@
+#include "LobbyPeers.hpp"
+#include "LobbyServer.hpp"
+#include "SharedPayload.hpp"
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+
+void LobbyPeers::setPeers(const std::vector<std::string>& addrs) {
+    m_links.clear();
+    for (const auto& a : addrs) {
+        if (m_links.size() == kMaxPeers) {
+            std::cerr << "[Lobby] Too many peers, ignoring " << a << "\n";
+            continue;
+        }
+        Link link;
+        link.addr = a;
+        m_links.push_back(link);
+    }
+}
+
+void LobbyPeers::start(ISteamNetworkingSockets* iface) {
+    m_iface = iface;
+    m_nextSync = Clock::now() + kSyncInterval;
+    for (auto& link : m_links) connect(link);
+}
+
+void LobbyPeers::stop() {
+    if (!m_iface) return;
+
+    for (auto& link : m_links) {
+        if (link.conn != k_HSteamNetConnection_Invalid) m_iface->CloseConnection(link.conn, 0, "lobby stop", false);
+        link.conn = k_HSteamNetConnection_Invalid;
+        link.connected = false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_newSubscribersMutex);
+        m_newSubscribers.clear();
+    }
+    m_subscribers.clear();
+    m_sent.clear();
+    m_pending.clear();
+    m_iface = nullptr;
+}
+
+void LobbyPeers::connect(Link& link) {
+    SteamNetworkingIPAddr addr;
+    addr.Clear();
+    if (!addr.ParseString(link.addr.c_str())) {
+        std::cerr << "[Lobby] Bad peer address: " << link.addr << "\n";
+        link.reconnectAt = Clock::time_point::max();
+        return;
+    }
+
+    link.conn = m_iface->ConnectByIPAddress(addr, 0, nullptr);
+    if (link.conn == k_HSteamNetConnection_Invalid) link.reconnectAt = Clock::now() + kReconnectDelay;
+}
+
+bool LobbyPeers::ownsConn(HSteamNetConnection conn) const {
+    for (const auto& link : m_links) {
+        if (link.conn == conn) return true;
+    }
+    return false;
+}
+
+void LobbyPeers::onConnStatusChanged(SteamNetConnectionStatusChangedCallback_t* info) {
+    size_t index = 0;
+    while (index < m_links.size() && m_links[index].conn != info->m_hConn) ++index;
+    if (index == m_links.size()) return;
+    Link& link = m_links[index];
+
+    const auto state = info->m_info.m_eState;
+    if (state == k_ESteamNetworkingConnectionState_Connected) {
+        link.connected = true;
+        std::cout << "[Lobby] Peer link up: " << link.addr << "\n";
+
+        lobby::PeerHello h{};
+        h.type = lobby::Type::PeerHello;
+        h.protocol = lobby::kProtocol;
+        m_iface->SendMessageToConnection(link.conn, &h, sizeof(h), k_nSteamNetworkingSend_Reliable, nullptr);
+        return;
+    }
+
+    if (state == k_ESteamNetworkingConnectionState_ClosedByPeer ||
+        state == k_ESteamNetworkingConnectionState_ProblemDetectedLocally) {
+        linkLost(index, info->m_info.m_szEndDebug);
+    }
+}
+
+void LobbyPeers::linkLost(size_t index, const char* why) {
+    Link& link = m_links[index];
+    m_iface->CloseConnection(link.conn, 0, "peer link lost", false);
+
+    // Can't tell which of its sessions are still alive, so unlist them all until it's back
+    if (link.connected) {
+        std::cout << "[Lobby] Peer link down: " << link.addr << " (" << why << ")\n";
+
+        LobbyShard::PeerUpdate drop{};
+        drop.op = LobbyShard::PeerUpdate::DropOrigin;
+        drop.origin = (uint8_t)(index + 1);
+        const std::vector<LobbyShard::PeerUpdate> updates{ drop };
+        for (uint32_t i = 0; i < m_server.shardCount(); ++i) m_server.shard(i).postPeer(updates);
+    }
+
+    link.conn = k_HSteamNetConnection_Invalid;
+    link.connected = false;
+    link.reconnectAt = Clock::now() + kReconnectDelay;
+}
+
+void LobbyPeers::addSubscriber(HSteamNetConnection conn) {
+    std::lock_guard<std::mutex> lock(m_newSubscribersMutex);
+    m_newSubscribers.push_back(conn);
+}
+
+bool LobbyPeers::isPeerAddress(const SteamNetworkingIPAddr& remote) const {
+    // m_links is only resized by setPeers, before any shard runs
+    for (const auto& link : m_links) {
+        SteamNetworkingIPAddr addr;
+        addr.Clear();
+        if (addr.ParseString(link.addr.c_str()) && std::memcmp(addr.m_ipv6, remote.m_ipv6, sizeof(addr.m_ipv6)) == 0) return true;
+    }
+    return false;
+}
+
+void LobbyPeers::subscriberClosed(HSteamNetConnection conn) {
+    m_subscribers.erase(std::remove(m_subscribers.begin(), m_subscribers.end(), conn), m_subscribers.end());
+
+    std::lock_guard<std::mutex> lock(m_newSubscribersMutex);
+    m_newSubscribers.erase(std::remove(m_newSubscribers.begin(), m_newSubscribers.end(), conn), m_newSubscribers.end());
+}
+
+void LobbyPeers::receive() {
+    SteamNetworkingMessage_t* msgs[32];
+    for (size_t i = 0; i < m_links.size(); ++i) {
+        if (!m_links[i].connected) continue;
+
+        for (;;) {
+            const int n = m_iface->ReceiveMessagesOnConnection(m_links[i].conn, msgs, 32);
+            if (n <= 0) break;
+
+            for (int k = 0; k < n; ++k) {
+                applySync((uint8_t)(i + 1), (const uint8_t*)msgs[k]->m_pData, (uint32_t)msgs[k]->m_cbSize);
+                msgs[k]->Release();
+            }
+        }
+    }
+}
+
+void LobbyPeers::applySync(uint8_t origin, const uint8_t* data, uint32_t size) {
+    if (size < sizeof(lobby::PeerSyncHdr)) return;
+
+    lobby::PeerSyncHdr hdr{};
+    std::memcpy(&hdr, data, sizeof(hdr));
+    if (hdr.type != lobby::Type::PeerSync) return;
+
+    const size_t entryBytes = (size_t)hdr.count * sizeof(lobby::SessionEntry);
+    const size_t playersBytes = (size_t)hdr.playersCount * sizeof(lobby::PeerPlayers);
+    const size_t removedBytes = (size_t)hdr.removedCount * sizeof(uint64_t);
+    const size_t fixedBytes = sizeof(hdr) + entryBytes + playersBytes + removedBytes;
+    if (size < fixedBytes) return;
+
+    const uint8_t* entries = data + sizeof(hdr);
+    const uint8_t* players = entries + entryBytes;
+    const uint8_t* removed = players + playersBytes;
+    const uint8_t* addrs = data + fixedBytes;
+    const size_t addrCount = (size - fixedBytes) / sizeof(lobby::SessionAddr6);
+
+    // One post per shard for the whole message
+    std::vector<std::vector<LobbyShard::PeerUpdate>> routed(m_server.shardCount());
+    auto route = [&](const LobbyShard::PeerUpdate& u) { routed[m_server.shardFor(u.entry.sessionKey).index()].push_back(u); };
+
+    if (hdr.flags & lobby::PeerSyncFull) {
+        for (auto& r : routed) {
+            LobbyShard::PeerUpdate drop{};
+            drop.op = LobbyShard::PeerUpdate::DropOrigin;
+            drop.origin = origin;
+            r.push_back(drop);
+        }
+    }
+
+    size_t nextAddr = 0;
+    for (uint16_t i = 0; i < hdr.count; ++i) {
+        LobbyShard::PeerUpdate u{};
+        u.op = LobbyShard::PeerUpdate::Upsert;
+        u.origin = origin;
+        std::memcpy(&u.entry, entries + (size_t)i * sizeof(u.entry), sizeof(u.entry));
+
+        if (u.entry.addrFamily == lobby::AddrIPv6) {
+            if (nextAddr == addrCount) return; // truncated
+            lobby::SessionAddr6 a{};
+            std::memcpy(&a, addrs + nextAddr++ * sizeof(a), sizeof(a));
+            if (a.sessionKey != u.entry.sessionKey) return;
+            std::memcpy(u.ipv6, a.ipv6, sizeof(u.ipv6));
+        }
+        if (u.entry.sessionKey != 0) route(u);
+    }
+
+    for (uint16_t i = 0; i < hdr.playersCount; ++i) {
+        lobby::PeerPlayers p{};
+        std::memcpy(&p, players + (size_t)i * sizeof(p), sizeof(p));
+
+        LobbyShard::PeerUpdate u{};
+        u.op = LobbyShard::PeerUpdate::Players;
+        u.origin = origin;
+        u.entry.sessionKey = p.sessionKey;
+        u.entry.curPlayers = p.curPlayers;
+        u.entry.state = p.state;
+        if (u.entry.sessionKey != 0) route(u);
+    }
+
+    for (uint16_t i = 0; i < hdr.removedCount; ++i) {
+        LobbyShard::PeerUpdate u{};
+        u.op = LobbyShard::PeerUpdate::Remove;
+        u.origin = origin;
+        std::memcpy(&u.entry.sessionKey, removed + (size_t)i * sizeof(uint64_t), sizeof(uint64_t));
+        if (u.entry.sessionKey != 0) route(u);
+    }
+
+    for (uint32_t i = 0; i < m_server.shardCount(); ++i) {
+        if (!routed[i].empty()) m_server.shard(i).postPeer(routed[i]);
+    }
+}
+
+void LobbyPeers::collectChanges() {
+    m_changes.clear();
+    for (uint32_t i = 0; i < m_server.shardCount(); ++i) m_server.shard(i).takePeerChanges(m_changes);
+
+    for (const auto& c : m_changes) {
+        const uint64_t key = c.entry.sessionKey;
+        if (c.removed) {
+            if (m_sent.erase(key)) m_pending[key] = PendingRemoved;
+            continue;
+        }
+
+        auto it = m_sent.find(key);
+        if (it == m_sent.end()) {
+            Sent& s = m_sent[key];
+            s.entry = c.entry;
+            std::memcpy(s.ipv6, c.ipv6, sizeof(s.ipv6));
+            m_pending[key] = PendingFull;
+            continue;
+        }
+
+        // Only what differs from the last state sent goes out, and a players/state change alone
+        // goes out as a PeerPlayers record
+        Sent& s = it->second;
+        lobby::SessionEntry rest = s.entry;
+        rest.curPlayers = c.entry.curPlayers;
+        rest.state = c.entry.state;
+        const bool onlyPlayers = std::memcmp(&rest, &c.entry, sizeof(rest)) == 0 && std::memcmp(s.ipv6, c.ipv6, sizeof(s.ipv6)) == 0;
+        if (onlyPlayers && s.entry.curPlayers == c.entry.curPlayers && s.entry.state == c.entry.state) continue;
+
+        s.entry = c.entry;
+        std::memcpy(s.ipv6, c.ipv6, sizeof(s.ipv6));
+
+        Pending& p = m_pending[key];
+        if (!onlyPlayers) p = PendingFull;
+        else if (p != PendingFull) p = PendingPlayers;
+    }
+}
+
+void LobbyPeers::sync(Clock::time_point now) {
+    for (auto& link : m_links) {
+        if (link.conn == k_HSteamNetConnection_Invalid && now >= link.reconnectAt) connect(link);
+    }
+
+    if (now < m_nextSync) return;
+    m_nextSync = now + kSyncInterval;
+
+    collectChanges();
+    if (!m_pending.empty()) {
+        if (!m_subscribers.empty()) sendBatch(m_subscribers, false);
+        m_pending.clear();
+    }
+
+    // Newcomers get everything as of now, which already includes the batch above
+    std::vector<HSteamNetConnection> fresh;
+    {
+        std::lock_guard<std::mutex> lock(m_newSubscribersMutex);
+        fresh.swap(m_newSubscribers);
+    }
+    fresh.erase(std::remove_if(fresh.begin(), fresh.end(), [&](HSteamNetConnection c) {
+        return std::find(m_subscribers.begin(), m_subscribers.end(), c) != m_subscribers.end();
+    }), fresh.end());
+    if (fresh.empty()) return;
+
+    sendBatch(fresh, true);
+    m_subscribers.insert(m_subscribers.end(), fresh.begin(), fresh.end());
+}
+
+void LobbyPeers::sendBatch(const std::vector<HSteamNetConnection>& to, bool full) {
+    std::vector<const Sent*> entries;
+    std::vector<lobby::PeerPlayers> players;
+    std::vector<uint64_t> removed;
+    if (full) {
+        entries.reserve(m_sent.size());
+        for (const auto& kv : m_sent) entries.push_back(&kv.second);
+    }
+    else {
+        for (const auto& kv : m_pending) {
+            if (kv.second == PendingRemoved) {
+                removed.push_back(kv.first);
+                continue;
+            }
+            const Sent& s = m_sent.at(kv.first);
+            if (kv.second == PendingFull) entries.push_back(&s);
+            else players.push_back(lobby::PeerPlayers{ kv.first, s.entry.curPlayers, s.entry.state });
+        }
+    }
+
+    // Split so no message gets near GNS's size limit; only a full copy's first part is flagged
+    std::vector<SteamNetworkingMessage_t*> msgs;
+    size_t e = 0, p = 0, r = 0;
+    bool first = true;
+    do {
+        const size_t ne = std::min(kMaxSyncRecords, entries.size() - e);
+        const size_t np = std::min(kMaxSyncRecords, players.size() - p);
+        const size_t nr = std::min(kMaxSyncRecords, removed.size() - r);
+
+        lobby::PeerSyncHdr hdr{};
+        hdr.type = lobby::Type::PeerSync;
+        hdr.flags = (full && first) ? lobby::PeerSyncFull : 0;
+        hdr.count = (uint16_t)ne;
+        hdr.playersCount = (uint16_t)np;
+        hdr.removedCount = (uint16_t)nr;
+
+        std::vector<lobby::SessionAddr6> addrs;
+        std::vector<uint8_t> bytes(sizeof(hdr) + ne * sizeof(lobby::SessionEntry) + np * sizeof(lobby::PeerPlayers) + nr * sizeof(uint64_t));
+        uint8_t* out = bytes.data();
+        std::memcpy(out, &hdr, sizeof(hdr));
+        out += sizeof(hdr);
+        for (size_t i = e; i < e + ne; ++i) {
+            std::memcpy(out, &entries[i]->entry, sizeof(lobby::SessionEntry));
+            out += sizeof(lobby::SessionEntry);
+            if (entries[i]->entry.addrFamily == lobby::AddrIPv6) {
+                lobby::SessionAddr6 a{};
+                a.sessionKey = entries[i]->entry.sessionKey;
+                std::memcpy(a.ipv6, entries[i]->ipv6, sizeof(a.ipv6));
+                addrs.push_back(a);
+            }
+        }
+        if (np) std::memcpy(out, players.data() + p, np * sizeof(lobby::PeerPlayers));
+        out += np * sizeof(lobby::PeerPlayers);
+        if (nr) std::memcpy(out, removed.data() + r, nr * sizeof(uint64_t));
+
+        const size_t at = bytes.size();
+        bytes.resize(at + addrs.size() * sizeof(lobby::SessionAddr6));
+        if (!addrs.empty()) std::memcpy(bytes.data() + at, addrs.data(), addrs.size() * sizeof(lobby::SessionAddr6));
+
+        // Every peer gets the same bytes
+        SharedPayload* payload = SharedPayload::create(std::move(bytes));
+        for (HSteamNetConnection conn : to) msgs.push_back(payload->makeMessage(conn, k_nSteamNetworkingSend_Reliable));
+        payload->release();
+
+        e += ne;
+        p += np;
+        r += nr;
+        first = false;
+    } while (e < entries.size() || p < players.size() || r < removed.size());
+
+    m_iface->SendMessages((int)msgs.size(), msgs.data(), nullptr);
+}
+
+LobbyPeers::Clock::time_point LobbyPeers::nextDeadline() const {
+    auto at = m_nextSync;
+    for (const auto& link : m_links) {
+        if (link.conn == k_HSteamNetConnection_Invalid) at = std::min(at, link.reconnectAt);
+    }
+    return at;
+}
\ No newline at end of file
@@ -0,0 +1,98 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <mutex>
+#include <unordered_map>
+#include <cstdint>
+#include <chrono>
+
+#include <steam/steamnetworkingsockets.h>
+#include <steam/isteamnetworkingsockets.h>
+#include <steam/steamnetworkingtypes.h>
+#include <steam/isteamnetworkingutils.h>
+
+#include "LobbyProtocol.hpp"
+#include "LobbyShard.hpp"
+
+class LobbyServer;
+
+// Federation with other lobby processes, so a browser on any of them sees every session.
+//
+// Each lobby connects out to every peer it was given and sends PeerHello; the peer streams the
+// sessions its own hosts announced back over that link (PeerSync). Sessions from a peer go into
+// the shards as owner-less entries tagged with the link they came from, and disappear when the
+// peer removes them or the link drops. Only locally announced sessions are sent on, so every lobby
+// has to list the others.
+//
+// Outgoing, the shards report their own sessions' changes; this keeps the last state sent and
+// every kSyncInterval sends peers one batch with just the difference (players/state-only changes
+// as 10-byte records). Everything here runs on the thread that calls LobbyServer::pump(), except
+// addSubscriber().
+class LobbyPeers {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit LobbyPeers(LobbyServer& server) : m_server(server) {}
+
+    void setPeers(const std::vector<std::string>& addrs); // before start
+    bool enabled() const { return !m_links.empty(); }
+
+    void start(ISteamNetworkingSockets* iface);
+    void stop();
+
+    // Our outgoing links to peers (their status callbacks come here, not to the listen socket path)
+    bool ownsConn(HSteamNetConnection conn) const;
+    void onConnStatusChanged(SteamNetConnectionStatusChangedCallback_t* info);
+
+    // A peer's link to us sent PeerHello (any thread); it gets a full copy at the next sync
+    void addSubscriber(HSteamNetConnection conn);
+    // Any thread: does `remote` have the IP of a configured peer? (its links come from any port)
+    bool isPeerAddress(const SteamNetworkingIPAddr& remote) const;
+    void subscriberClosed(HSteamNetConnection conn);
+
+    void receive();                   // before the shards pump: apply what peers sent
+    void sync(Clock::time_point now); // after: send our changes, reconnect dropped links
+    Clock::time_point nextDeadline() const;
+
+private:
+    struct Link {
+        std::string addr;
+        HSteamNetConnection conn{ k_HSteamNetConnection_Invalid };
+        bool connected{ false };
+        Clock::time_point reconnectAt{};
+    };
+
+    // Last state of one of our sessions as sent to peers
+    struct Sent {
+        lobby::SessionEntry entry;
+        uint8_t ipv6[16];
+    };
+    enum Pending : uint8_t { PendingNone, PendingPlayers, PendingFull, PendingRemoved };
+
+    void connect(Link& link);
+    void linkLost(size_t index, const char* why);
+    void applySync(uint8_t origin, const uint8_t* data, uint32_t size);
+    void collectChanges();
+    void sendBatch(const std::vector<HSteamNetConnection>& to, bool full);
+
+private:
+    LobbyServer& m_server;
+    ISteamNetworkingSockets* m_iface{ nullptr };
+
+    std::vector<Link> m_links; // index + 1 = origin tag of the sessions learned over it
+
+    std::mutex m_newSubscribersMutex;
+    std::vector<HSteamNetConnection> m_newSubscribers;
+    std::vector<HSteamNetConnection> m_subscribers; // have had their full copy
+
+    std::unordered_map<uint64_t, Sent> m_sent;        // our sessions, as peers know them
+    std::unordered_map<uint64_t, Pending> m_pending;  // what the next batch has to say per key
+    std::vector<LobbyShard::PeerRecord> m_changes;    // scratch
+
+    Clock::time_point m_nextSync{};
+
+    static constexpr size_t kMaxPeers = 32;
+    static constexpr std::chrono::milliseconds kSyncInterval{ 250 };
+    static constexpr std::chrono::seconds kReconnectDelay{ 2 };
+    static constexpr size_t kMaxSyncRecords = 1024; // per list per PeerSync message (~60 KB at most)
+};
\ No newline at end of file
@@ -3,7 +3,7 @@
 
 namespace lobby {
 
-    static constexpr uint32_t kProtocol = 1;
+    static constexpr uint32_t kProtocol = 8; // 2: versioned/delta ListResp, 3: filtered/paged ListReq, 4: QuickMatch, 5: Stats, 6: rate-limit counters, 7: IPv6 hosts, 8: federation
 
     enum class Type : uint8_t {
         Hello = 1,
@@ -12,6 +12,14 @@ namespace lobby {
         ListReq = 4,  // client -> lobby
         ListResp = 5,  // lobby -> client
         Claim = 6,  // new host -> lobby (take over existing sessionKey during grace)
+        Subscribe = 7,  // client -> lobby (ListReq payload; lobby then pushes ListResp on every change)
+        Unsubscribe = 8,  // client -> lobby
+        QuickMatch = 9,  // client -> lobby (pick one joinable session for me)
+        QuickMatchResp = 10,  // lobby -> client
+        StatsReq = 11,  // any -> lobby (health report for the last stats window)
+        StatsResp = 12,  // lobby -> requester
+        PeerHello = 13,  // lobby -> peer lobby (send me your sessions, then their changes)
+        PeerSync = 14,  // peer lobby -> lobby (sessions announced to the peer)
     };
 
     enum class SessionState : uint8_t {
@@ -20,6 +28,35 @@ namespace lobby {
         Migrating = 3,
     };
 
+    enum class ListKind : uint8_t {
+        Full = 1,       // count entries = the whole list, or its lowest sessionKeys past the lobby's cap
+        Delta = 2,      // count added/updated entries, then removedCount uint64 sessionKeys
+        Unchanged = 3,  // client already holds listVersion; no payload
+        Page = 4,       // answer to a paged ListReq: count matching entries, resume at nextCursor
+    };
+
+    // ListReq.filterFlags: which filter fields apply (paged requests only)
+    enum ListFilter : uint8_t {
+        FilterOpenOnly = 1 << 0,  // state == Open
+        FilterMinFree = 1 << 1,   // maxPlayers - curPlayers - QuickMatch holds >= minFreeSlots
+        FilterName = 1 << 2,      // name starts with namePrefix
+        FilterWorldSeed = 1 << 3, // worldSeed matches exactly
+    };
+
+    // SessionEntry.addrFamily
+    enum AddrFamily : uint8_t {
+        AddrIPv4 = 0,  // ipv4_host_order
+        AddrIPv6 = 1,  // in a SessionAddr6 after the message's entries (ipv4_host_order is 0)
+    };
+
+    // PeerSyncHdr.flags
+    enum PeerSyncFlags : uint8_t {
+        PeerSyncFull = 1 << 0,  // start of a full copy: forget every session this peer sent before
+    };
+
+    static constexpr uint8_t kMaxPageEntries = 16; // keeps a Page in one ~1 KB packet (no fragmentation)
+    static constexpr uint32_t kStatsMsgTypes = 16;  // StatsResp.messages slots, by Type value
+
 #pragma pack(push, 1)
 
     struct Hello {
@@ -47,17 +84,39 @@ namespace lobby {
     };
 
     struct ListReq {
-        Type     type;      // ListReq
-        uint32_t protocol;  // kProtocol
+        Type     type;         // ListReq or Subscribe (same payload)
+        uint32_t protocol;     // kProtocol
+        uint32_t listEpoch;    // from the last ListResp applied (0 = none)
+        uint32_t listVersion;  // from the last ListResp applied (0 = none)
+
+        // pageSize != 0 asks for one Page of matching sessions instead of the versioned list
+        // (ListReq only; Subscribe ignores these fields)
+        uint8_t  pageSize;      // 1..kMaxPageEntries
+        uint8_t  filterFlags;   // ListFilter bits
+        uint8_t  minFreeSlots;
+        uint8_t  reserved0;
+        uint32_t worldSeed;
+        uint64_t cursor;        // nextCursor from the previous Page (0 = start)
+        char     namePrefix[16];
+    };
+
+    struct Unsubscribe {
+        Type type;  // Unsubscribe
     };
 
     struct ListRespHdr {
-        Type     type;   // ListResp
-        uint16_t count;  // number of entries
-        uint16_t reserved0;
+        Type     type;          // ListResp
+        ListKind kind;
+        uint16_t count;         // SessionEntry records that follow
+        uint16_t removedCount;  // Delta: uint64 sessionKeys following the entries
+        uint32_t listEpoch;     // changes whenever the lobby restarts (versions restart too)
+        uint32_t baseVersion;   // Delta/Unchanged: version this applies on top of
+        uint32_t listVersion;   // version the client holds after applying
+        uint64_t nextCursor;    // Page: pass back as ListReq.cursor for more (0 = no more)
     };
 
-    // IPv4-only for prototype
+    // Fixed size so lists stay flat arrays; an IPv6 host's address doesn't fit, so it travels
+    // separately (SessionAddr6) and IPv4-only lists cost nothing extra
     struct SessionEntry {
         uint64_t sessionKey;
 
@@ -70,11 +129,92 @@ namespace lobby {
         uint32_t worldSeed;
 
         SessionState state;
-        uint8_t reserved1[3];
+        uint8_t addrFamily;  // AddrFamily
+        uint8_t reserved1[2];
 
         char name[32];
     };
 
+    // Address of an AddrIPv6 entry. ListResp and QuickMatchResp end with one of these per AddrIPv6
+    // entry they carry, in entry order (after a Delta's removed keys).
+    struct SessionAddr6 {
+        uint64_t sessionKey;
+        uint8_t  ipv6[16];  // as SteamNetworkingIPAddr::m_ipv6
+    };
+
+    struct QuickMatch {
+        Type     type;         // QuickMatch
+        uint32_t protocol;     // kProtocol
+        uint8_t  reserveSlot;  // 1 = hold a slot for us briefly so other quick-matchers go elsewhere
+    };
+
+    struct QuickMatchResp {
+        Type     type;         // QuickMatchResp
+        uint8_t  found;        // 0 = no joinable session right now
+        uint16_t reservedMs;   // how long the slot is held (0 = not reserved)
+        SessionEntry entry;    // valid if found
+    };
+
+    struct StatsReq {
+        Type     type;      // StatsReq
+        uint32_t protocol;  // kProtocol
+    };
+
+    // Lobby health over the last complete stats window. Counts cover the window (divide by
+    // windowMs for rates); sessions/connections/subscribers are current at the window's end.
+    struct StatsResp {
+        Type     type;         // StatsResp
+        uint8_t  workers;
+        uint16_t reserved0;
+        uint32_t windowMs;     // 0 = no window completed yet
+        uint32_t uptimeSec;
+
+        uint32_t sessionsOpen;
+        uint32_t sessionsFull;
+        uint32_t sessionsMigrating;
+        uint32_t connections;
+        uint32_t subscribers;
+
+        uint32_t messages[kStatsMsgTypes];  // received, by Type value (slot 0 = unknown type)
+        uint32_t dropped[kStatsMsgTypes];   // received but over the sender's request budget (included in messages)
+
+        uint32_t listResponses;  // ListResp sent (answers and pushes)
+        uint32_t listBytesP50;
+        uint32_t listBytesP99;
+        uint32_t listBytesMax;
+        uint32_t listLatencyP50Us;  // ListReq receive -> ListResp send
+        uint32_t listLatencyP99Us;
+        uint32_t listLatencyMaxUs;
+        uint32_t pumpP50Us;         // pumps that handled at least one message
+        uint32_t pumpP99Us;
+        uint32_t pumpMaxUs;
+        uint32_t cleanupP99Us;      // per pump, when TTL/grace/reservation cleanup had work
+        uint32_t cleanupMaxUs;
+    };
+
+    // Federation: a lobby started with peers connects to each and sends PeerHello. The peer answers
+    // on that connection with the sessions its own hosts announced: all of them first (PeerSyncFull),
+    // then a batch of whatever changed every so often. Sessions learned from a peer aren't passed on.
+    struct PeerHello {
+        Type     type;      // PeerHello
+        uint32_t protocol;  // kProtocol
+    };
+
+    struct PeerSyncHdr {
+        Type     type;          // PeerSync
+        uint8_t  flags;         // PeerSyncFlags
+        uint16_t count;         // SessionEntry records (new or re-announced sessions) that follow
+        uint16_t playersCount;  // then PeerPlayers records
+        uint16_t removedCount;  // then uint64 sessionKeys, then a SessionAddr6 per AddrIPv6 entry
+    };
+
+    // A session whose only change is its player count / state, i.e. most heartbeats
+    struct PeerPlayers {
+        uint64_t     sessionKey;
+        uint8_t      curPlayers;
+        SessionState state;
+    };
+
 #pragma pack(pop)
 
 } // namespace lobby
\ No newline at end of file
@@ -1,10 +1,11 @@
 #include "LobbyServer.hpp"
-#include <cstring>
 #include <iostream>
 #include <algorithm>
+#include <random>
 
-bool LobbyServer::start(ISteamNetworkingSockets* iface, uint16_t port) {
+bool LobbyServer::start(ISteamNetworkingSockets* iface, uint16_t port, uint32_t workers) {
     m_iface = iface;
+    workers = std::clamp<uint32_t>(workers, 1, kMaxWorkers);
 
     SteamNetworkingIPAddr addr;
     addr.Clear();
@@ -16,62 +17,86 @@ bool LobbyServer::start(ISteamNetworkingSockets* iface, uint16_t port) {
         return false;
     }
 
-    m_poll = m_iface->CreatePollGroup();
-    if (m_poll == k_HSteamNetPollGroup_Invalid) {
-        std::cerr << "[Lobby] CreatePollGroup failed\n";
-        return false;
+    // Clients holding a list version from a previous run must get a Full list
+    m_listEpoch = 0;
+    while (m_listEpoch == 0) m_listEpoch = (uint32_t)std::random_device{}();
+
+    m_startedAt = m_windowStart = Clock::now();
+    {
+        std::lock_guard<std::mutex> lock(m_reportMutex);
+        m_report = lobby::StatsResp{};
+        m_report.type = lobby::Type::StatsResp;
+        m_report.workers = (uint8_t)workers;
+    }
+
+    m_rcu.init(workers);
+    for (uint32_t i = 0; i < workers; ++i) {
+        m_shards.push_back(std::make_unique<LobbyShard>(*this, i));
+        if (!m_shards.back()->start(m_iface)) {
+            stop();
+            return false;
+        }
+    }
+
+    // Restored sessions are routed to their shards before any worker runs
+    if (persisting()) restoreSessions();
+    m_nextPersist = Clock::now() + kPersistInterval;
+
+    // All shards exist before any worker can route to one
+    m_stopping = false;
+    if (workers > 1) {
+        for (uint32_t i = 0; i < workers; ++i) m_workers.emplace_back(&LobbyServer::workerMain, this, i);
     }
 
-    std::cout << "[Lobby] Listening on UDP port " << port << "\n";
+    std::cout << "[Lobby] Listening on UDP port " << port;
+    if (workers > 1) std::cout << " (" << workers << " workers)";
+    std::cout << "\n";
+
+    m_peers.start(m_iface);
+    m_started = true;
     return true;
 }
 
 void LobbyServer::stop() {
     if (!m_iface) return;
 
-    for (auto& kv : m_connToSession) {
-        m_iface->CloseConnection(kv.first, 0, "lobby stop", false);
+    m_peers.stop();
+    stopWorkers();
+
+    // Workers are gone, so the shards' tables can be exported from here
+    if (m_started && persisting()) {
+        for (auto& s : m_shards) s->exportSessions();
+        persistSessions(true);
     }
+    m_started = false;
 
-    m_connToSession.clear();
-    m_sessions.clear();
+    for (auto& s : m_shards) s->stop();
+    m_shards.clear();
+    m_conns.clear();
 
-    if (m_poll != k_HSteamNetPollGroup_Invalid) {
-        m_iface->DestroyPollGroup(m_poll);
-        m_poll = k_HSteamNetPollGroup_Invalid;
-    }
     if (m_listen != k_HSteamListenSocket_Invalid) {
         m_iface->CloseListenSocket(m_listen);
         m_listen = k_HSteamListenSocket_Invalid;
     }
 }
 
-bool LobbyServer::fillRemoteIPv4(HSteamNetConnection from, uint32_t& outIpHostOrder) {
-    SteamNetConnectionInfo_t ci{};
-    if (!m_iface->GetConnectionInfo(from, &ci)) return false;
-
-    const uint32_t ip = ci.m_addrRemote.GetIPv4();
-    if (ip == 0) return false; // ipv6-only not handled in this prototype
-
-    outIpHostOrder = ip; // host order
-    return true;
-}
-
-void LobbyServer::markMigrating(uint64_t sessionKey) {
-    auto it = m_sessions.find(sessionKey);
-    if (it == m_sessions.end()) return;
-
-    auto& s = it->second;
-    s.state = lobby::SessionState::Migrating;
-    s.ownerConn = k_HSteamNetConnection_Invalid;
-    s.migratingSince = Clock::now();
+LobbyShard& LobbyServer::shardFor(uint64_t sessionKey) {
+    // Keys are random, but mix anyway so a poor key generator can't pile onto one shard
+    const uint64_t h = sessionKey * 0x9E3779B97F4A7C15ull;
+    return *m_shards[(uint32_t)(h >> 32) % (uint32_t)m_shards.size()];
 }
 
 void LobbyServer::onConnStatusChanged(SteamNetConnectionStatusChangedCallback_t* info) {
     const auto state = info->m_info.m_eState;
     const auto conn = info->m_hConn;
 
-    // Only care about conns on our listen socket
+    // Our own links out to peer lobbies
+    if (m_peers.ownsConn(conn)) {
+        m_peers.onConnStatusChanged(info);
+        return;
+    }
+
+    // Otherwise only care about conns on our listen socket
     if (info->m_info.m_hListenSocket != m_listen) return;
 
     if (state == k_ESteamNetworkingConnectionState_Connecting) {
@@ -80,192 +105,157 @@ void LobbyServer::onConnStatusChanged(SteamNetConnectionStatusChangedCallback_t*
             m_iface->CloseConnection(conn, 0, "AcceptConnection failed", false);
             return;
         }
-        m_iface->SetConnectionPollGroup(conn, m_poll);
+        m_iface->SetConnectionPollGroup(conn, m_shards[m_nextConnShard]->pollGroup());
+        m_conns.insert(conn);
+        m_nextConnShard = (m_nextConnShard + 1) % (uint32_t)m_shards.size();
         return;
     }
 
     if (state == k_ESteamNetworkingConnectionState_ClosedByPeer ||
         state == k_ESteamNetworkingConnectionState_ProblemDetectedLocally) {
 
-        // If this connection owned a session, mark it migrating (grace period)
-        auto it = m_connToSession.find(conn);
-        if (it != m_connToSession.end()) {
-            const uint64_t key = it->second;
-            m_connToSession.erase(it);
-            markMigrating(key);
-        }
+        // The conn may own a session in any shard and be subscribed in its own; closes are rare
+        for (auto& s : m_shards) s->postConnClosed(conn);
+        m_conns.erase(conn);
+        if (federated()) m_peers.subscriberClosed(conn);
 
         m_iface->CloseConnection(conn, 0, "cleanup", false);
         return;
     }
 }
 
-void LobbyServer::handleMessage(HSteamNetConnection from, const void* data, uint32_t size) {
-    if (size < 1) return;
-    const auto type = *(const lobby::Type*)data;
-
-    if (type == lobby::Type::Hello) {
-        // optional; ignore
-        return;
-    }
-
-    if (type == lobby::Type::Announce || type == lobby::Type::Claim) {
-        if (size < sizeof(lobby::Announce)) return;
-        const auto* a = (const lobby::Announce*)data;
-        if (a->protocol != lobby::kProtocol) return;
-        if (a->sessionKey == 0) return;
-
-        uint32_t ipHostOrder{};
-        if (!fillRemoteIPv4(from, ipHostOrder)) return;
-
-        const auto now = Clock::now();
-
-        auto sit = m_sessions.find(a->sessionKey);
-        const bool exists = (sit != m_sessions.end());
-
-        // Claim rules:
-        // - if session exists and is Migrating: accept first claim, replace ownerConn
-        // - if session exists and is Open/Full: ignore Claim (prevents hijack)
-        // - Announce always creates/updates (host normal behavior)
-        if (type == lobby::Type::Claim) {
-            if (!exists) return;
-            if (sit->second.state != lobby::SessionState::Migrating) return;
-        }
+int LobbyServer::pump() {
+    if (m_shards.empty()) return 0;
 
-        Session s{};
-        if (exists) s = sit->second;
-
-        s.sessionKey = a->sessionKey;
-        s.ownerConn = from;
-        s.ipv4_host_order = ipHostOrder;
-        s.gamePort = a->gamePort;
-        s.maxPlayers = a->maxPlayers ? a->maxPlayers : 3;
-        s.worldSeed = a->worldSeed;
-        std::memcpy(s.name, a->name, sizeof(s.name));
-
-        // On announce/claim, reset timers
-        s.lastSeen = now;
-        s.migratingSince = Clock::time_point{};
+    const auto now = Clock::now();
+    if (now - m_windowStart >= kStatsWindow) rollStats(now);
 
-        // State computed from curPlayers unless migrating
-        if (s.curPlayers >= s.maxPlayers) s.state = lobby::SessionState::Full;
-        else s.state = lobby::SessionState::Open;
+    // Peer updates are posted to the shards, so they're applied in the pump below
+    if (federated()) m_peers.receive();
 
-        m_sessions[a->sessionKey] = s;
-        m_connToSession[from] = a->sessionKey;
-        return;
+    int handled = 0;
+    if (m_workers.empty()) handled = m_shards[0]->pump();
+    else {
+        // Something may have arrived on any poll group
+        for (auto& s : m_shards) s->wake();
     }
 
-    if (type == lobby::Type::Heartbeat) {
-        if (size < sizeof(lobby::Heartbeat)) return;
-        const auto* hb = (const lobby::Heartbeat*)data;
-        if (hb->sessionKey == 0) return;
-
-        // Only accept heartbeat from the current owner conn
-        auto sit = m_sessions.find(hb->sessionKey);
-        if (sit == m_sessions.end()) return;
+    if (federated()) m_peers.sync(now);
 
-        auto& s = sit->second;
-        if (s.ownerConn != from) return;
-        if (s.state == lobby::SessionState::Migrating) return;
-
-        s.curPlayers = (uint8_t)std::clamp<uint16_t>(hb->curPlayers, 1, s.maxPlayers);
-        s.lastSeen = Clock::now();
-        s.state = (s.curPlayers >= s.maxPlayers) ? lobby::SessionState::Full : lobby::SessionState::Open;
-        return;
-    }
+    // After the pump, so a single shard's export from this pump is written straight away
+    if (persisting() && now >= m_nextPersist) persistSessions(false);
+    return handled;
+}
 
-    if (type == lobby::Type::ListReq) {
-        if (size < sizeof(lobby::ListReq)) return;
-        const auto* lr = (const lobby::ListReq*)data;
-        if (lr->protocol != lobby::kProtocol) return;
-        sendList(from);
-        return;
-    }
+LobbyServer::Clock::time_point LobbyServer::nextDeadline() const {
+    if (m_shards.empty()) return Clock::time_point::max();
+    auto at = federated() ? m_peers.nextDeadline() : Clock::time_point::max();
+    if (!m_workers.empty()) return at;
+    at = std::min({ at, m_shards[0]->nextDeadline(), m_windowStart + kStatsWindow });
+    if (persisting()) at = std::min(at, m_nextPersist);
+    return at;
 }
 
-void LobbyServer::cleanupExpired() {
-    const auto now = Clock::now();
+void LobbyServer::drainListLatency(LatencyHistogram& out) {
+    for (auto& s : m_shards) s->drainListLatency(out);
+}
 
-    for (auto it = m_sessions.begin(); it != m_sessions.end(); ) {
-        auto& s = it->second;
-
-        // Active sessions: if TTL exceeded, mark migrating
-        if (s.state != lobby::SessionState::Migrating) {
-            if (now - s.lastSeen > kActiveTTL) {
-                markMigrating(s.sessionKey);
-                // refresh iterator reference after potential overwrite
-                it = m_sessions.find(s.sessionKey);
-                if (it == m_sessions.end()) continue;
-                ++it;
-                continue;
-            }
-        }
-        else {
-            // Migrating: if grace exceeded, delete
-            if (s.migratingSince != Clock::time_point{} && now - s.migratingSince > kGraceTTL) {
-                it = m_sessions.erase(it);
-                continue;
-            }
-        }
+lobby::StatsResp LobbyServer::statsReport() const {
+    std::lock_guard<std::mutex> lock(m_reportMutex);
+    return m_report;
+}
 
-        ++it;
+void LobbyServer::rollStats(Clock::time_point now) {
+    using namespace std::chrono;
+
+    m_window.resetWindow();
+    m_window.sessions.fill(0);
+    m_window.subscribers = 0;
+    for (auto& s : m_shards) s->drainStats(m_window);
+
+    const auto& w = m_window;
+    lobby::StatsResp r{};
+    r.type = lobby::Type::StatsResp;
+    r.workers = (uint8_t)m_shards.size();
+    r.windowMs = (uint32_t)duration_cast<milliseconds>(now - m_windowStart).count();
+    r.uptimeSec = (uint32_t)duration_cast<seconds>(now - m_startedAt).count();
+
+    r.sessionsOpen = w.sessions[(size_t)lobby::SessionState::Open];
+    r.sessionsFull = w.sessions[(size_t)lobby::SessionState::Full];
+    r.sessionsMigrating = w.sessions[(size_t)lobby::SessionState::Migrating];
+    r.connections = (uint32_t)m_conns.size();
+    r.subscribers = w.subscribers;
+
+    for (size_t i = 0; i < w.messages.size(); ++i) r.messages[i] = (uint32_t)w.messages[i];
+    for (size_t i = 0; i < w.dropped.size(); ++i) r.dropped[i] = (uint32_t)w.dropped[i];
+
+    r.listResponses = (uint32_t)w.listBytes.count();
+    r.listBytesP50 = (uint32_t)w.listBytes.percentile(0.50);
+    r.listBytesP99 = (uint32_t)w.listBytes.percentile(0.99);
+    r.listBytesMax = (uint32_t)w.listBytes.max();
+    r.listLatencyP50Us = (uint32_t)w.listLatency.percentile(0.50);
+    r.listLatencyP99Us = (uint32_t)w.listLatency.percentile(0.99);
+    r.listLatencyMaxUs = (uint32_t)w.listLatency.max();
+    r.pumpP50Us = (uint32_t)w.pumpUsec.percentile(0.50);
+    r.pumpP99Us = (uint32_t)w.pumpUsec.percentile(0.99);
+    r.pumpMaxUs = (uint32_t)w.pumpUsec.max();
+    r.cleanupP99Us = (uint32_t)w.cleanupUsec.percentile(0.99);
+    r.cleanupMaxUs = (uint32_t)w.cleanupUsec.max();
+
+    {
+        std::lock_guard<std::mutex> lock(m_reportMutex);
+        m_report = r;
     }
+    m_windowStart = now;
 }
 
-void LobbyServer::sendList(HSteamNetConnection to) {
-    cleanupExpired();
-
-    std::vector<lobby::SessionEntry> entries;
-    entries.reserve(m_sessions.size());
+void LobbyServer::restoreSessions() {
+    std::vector<lobby_snapshot::Record> records;
+    int64_t writtenAtMs = 0;
+    if (!lobby_snapshot::read(m_snapshotPath, records, writtenAtMs)) return;
 
-    for (auto& kv : m_sessions) {
-        const auto& s = kv.second;
+    const int64_t nowMs = lobby_snapshot::unixNowMs();
+    const int64_t ageMs = std::max<int64_t>(0, nowMs - writtenAtMs);
 
-        lobby::SessionEntry e{};
-        e.sessionKey = s.sessionKey;
-        e.ipv4_host_order = s.ipv4_host_order;
-        e.gamePort = s.gamePort;
-        e.curPlayers = s.curPlayers;
-        e.maxPlayers = s.maxPlayers;
-        e.worldSeed = s.worldSeed;
-        e.state = s.state;
-        std::memcpy(e.name, s.name, sizeof(e.name));
-
-        entries.push_back(e);
+    size_t restored = 0;
+    for (const auto& r : records) {
+        if (shardFor(r.sessionKey).restoreSession(r, nowMs, ageMs)) ++restored;
     }
 
-    lobby::ListRespHdr hdr{};
-    hdr.type = lobby::Type::ListResp;
-    hdr.count = (uint16_t)std::min<size_t>(entries.size(), 512);
+    std::cout << "[Lobby] Restored " << restored << "/" << records.size() << " sessions from "
+        << m_snapshotPath << " (written " << ageMs / 1000 << "s ago)\n";
+}
 
-    const size_t bytes = sizeof(hdr) + (size_t)hdr.count * sizeof(lobby::SessionEntry);
-    std::vector<uint8_t> buf(bytes);
+void LobbyServer::persistSessions(bool force) {
+    m_nextPersist = Clock::now() + kPersistInterval;
 
-    std::memcpy(buf.data(), &hdr, sizeof(hdr));
-    if (hdr.count) {
-        std::memcpy(buf.data() + sizeof(hdr), entries.data(), (size_t)hdr.count * sizeof(lobby::SessionEntry));
-    }
+    bool dirty = force;
+    for (auto& s : m_shards) dirty = dirty || s->exportDirty();
+    if (!dirty) return;
 
-    m_iface->SendMessageToConnection(
-        to, buf.data(), (uint32)buf.size(),
-        k_nSteamNetworkingSend_Reliable, nullptr
-    );
+    m_persistScratch.clear();
+    for (auto& s : m_shards) s->appendExport(m_persistScratch);
+    lobby_snapshot::write(m_snapshotPath, m_persistScratch);
 }
 
-void LobbyServer::pump() {
-    if (!m_iface || m_poll == k_HSteamNetPollGroup_Invalid) return;
+void LobbyServer::stopWorkers() {
+    m_stopping = true;
+    for (auto& s : m_shards) s->wake();
+    for (auto& t : m_workers) t.join();
+    m_workers.clear();
+}
 
-    cleanupExpired();
+void LobbyServer::workerMain(uint32_t index) {
+    LobbyShard& shard = *m_shards[index];
 
-    SteamNetworkingMessage_t* msgs[32];
-    for (;;) {
-        const int n = m_iface->ReceiveMessagesOnPollGroup(m_poll, msgs, 32);
-        if (n <= 0) break;
+    while (!m_stopping) {
+        m_rcu.quiescent(index);
+        shard.pump();
 
-        for (int i = 0; i < n; ++i) {
-            handleMessage(msgs[i]->m_conn, msgs[i]->m_pData, (uint32_t)msgs[i]->m_cbSize);
-            msgs[i]->Release();
-        }
+        // Holds no snapshots while asleep, so an idle worker never holds up reclamation
+        m_rcu.offline(index);
+        const auto now = Clock::now();
+        shard.waitForWork(std::min(shard.nextDeadline(), now + kWorkerMaxWait));
+        m_rcu.online(index);
     }
 }
\ No newline at end of file
@@ -1,6 +1,11 @@
 #pragma once
-#include <unordered_map>
 #include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <thread>
+#include <atomic>
 #include <cstdint>
 #include <chrono>
 
@@ -10,61 +15,98 @@
 #include <steam/isteamnetworkingutils.h>
 
 #include "LobbyProtocol.hpp"
-
+#include "LatencyHistogram.hpp"
+#include "LobbyStats.hpp"
+#include "LobbyShard.hpp"
+#include "LobbySnapshot.hpp"
+#include "LobbyPeers.hpp"
+#include "Rcu.hpp"
+
+// Owns the listen socket and deals connections out to shards. With one worker the single shard
+// is pumped from pump() on the caller's thread; with N workers each shard runs on its own
+// thread, owns the sessions whose key hashes to it, and pump() just wakes them.
 class LobbyServer {
 public:
-    bool start(ISteamNetworkingSockets* iface, uint16_t port);
-    void stop();
+    using Clock = LobbyShard::Clock;
 
-    void onConnStatusChanged(SteamNetConnectionStatusChangedCallback_t* info);
-    void pump(); // call frequently
+    ~LobbyServer() { stopWorkers(); } // threads must not outlive the shards; call stop() for the rest
 
-    HSteamListenSocket listenSocket() const { return m_listen; }
+    // Session snapshot file ("" = off, the default). Set before start(): start() re-lists the
+    // sessions in it, the table is rewritten every few seconds while running, and once more on stop().
+    void setSnapshotFile(const std::string& path) { m_snapshotPath = path; }
+    bool persisting() const { return !m_snapshotPath.empty(); }
 
-private:
-    using Clock = std::chrono::steady_clock;
-
-    struct Session {
-        uint64_t sessionKey{};
+    // Other lobbies ("host:port") to exchange sessions with; none = standalone, the default.
+    // Set before start(). Every lobby in the set has to list all the others.
+    void setPeers(const std::vector<std::string>& addrs) { m_peers.setPeers(addrs); }
+    bool federated() const { return m_peers.enabled(); }
 
-        // current lobby connection that "owns" the session (host's lobby conn)
-        HSteamNetConnection ownerConn{ k_HSteamNetConnection_Invalid };
+    bool start(ISteamNetworkingSockets* iface, uint16_t port, uint32_t workers = 1);
+    void stop();
 
-        uint32_t ipv4_host_order{};
-        uint16_t gamePort{};
-        uint8_t  curPlayers{ 1 };
-        uint8_t  maxPlayers{ 3 };
+    void onConnStatusChanged(SteamNetConnectionStatusChangedCallback_t* info);
+    int pump(); // call frequently; returns number of messages handled (0 when workers do it)
 
-        uint32_t worldSeed{};
-        char     name[32]{};
+    // Earliest point at which a session TTL/grace expiry or a peer sync needs a pump
+    // (time_point::max() if none; worker threads keep their shards' deadlines themselves)
+    Clock::time_point nextDeadline() const;
 
-        lobby::SessionState state{ lobby::SessionState::Open };
+    // ListReq receive -> ListResp send, in microseconds (includes time queued before pump).
+    // Moves every shard's samples into `out`.
+    void drainListLatency(LatencyHistogram& out);
 
-        Clock::time_point lastSeen{};
-        Clock::time_point migratingSince{};
-    };
+    // Health report for the last complete stats window (kStatsWindow, rolled from pump()).
+    // Any thread; this is also what a StatsReq gets back.
+    lobby::StatsResp statsReport() const;
 
-    void handleMessage(HSteamNetConnection from, const void* data, uint32_t size);
-    void sendList(HSteamNetConnection to);
+    HSteamListenSocket listenSocket() const { return m_listen; }
 
-    void cleanupExpired(); // TTL + grace cleanup
-    void markMigrating(uint64_t sessionKey);
+    // For shards
+    ISteamNetworkingSockets* iface() const { return m_iface; }
+    uint32_t listEpoch() const { return m_listEpoch; }
+    uint32_t shardCount() const { return (uint32_t)m_shards.size(); }
+    LobbyShard& shard(uint32_t i) { return *m_shards[i]; }
+    LobbyShard& shardFor(uint64_t sessionKey);
+    RcuDomain& rcu() { return m_rcu; } // readers = worker threads, by shard index
+    LobbyPeers& peers() { return m_peers; }
 
-    bool fillRemoteIPv4(HSteamNetConnection from, uint32_t& outIpHostOrder);
+private:
+    void workerMain(uint32_t index);
+    void stopWorkers();
+    void rollStats(Clock::time_point now);
+    void restoreSessions();
+    void persistSessions(bool force); // writes the shards' latest exports if any changed
 
 private:
     ISteamNetworkingSockets* m_iface{ nullptr };
     HSteamListenSocket m_listen{ k_HSteamListenSocket_Invalid };
-    HSteamNetPollGroup m_poll{ k_HSteamNetPollGroup_Invalid };
 
-    // host lobby connection -> sessionKey (only for current owner conns)
-    std::unordered_map<HSteamNetConnection, uint64_t> m_connToSession;
-
-    // sessionKey -> session record
-    std::unordered_map<uint64_t, Session> m_sessions;
-
-private:
-    // Tunables (keep lobby dumb but resilient)
-    static constexpr std::chrono::seconds kActiveTTL{ 12 };    // if no heartbeat, consider host gone
-    static constexpr std::chrono::seconds kGraceTTL{ 25 };     // time allowed for Claim after host loss
+    // Clients holding a list version from a previous run must get a Full list
+    uint32_t m_listEpoch{ 0 };
+
+    RcuDomain m_rcu;
+    std::vector<std::unique_ptr<LobbyShard>> m_shards;
+    std::vector<std::thread> m_workers;
+    std::atomic<bool> m_stopping{ false };
+    uint32_t m_nextConnShard{ 0 }; // round-robin for new connections
+    std::unordered_set<HSteamNetConnection> m_conns; // accepted and not closed yet
+
+    LobbyPeers m_peers{ *this };
+
+    // Stats windows; m_report is read by shards answering StatsReq
+    Clock::time_point m_startedAt{};
+    Clock::time_point m_windowStart{};
+    LobbyStats m_window; // scratch for merging shards
+    mutable std::mutex m_reportMutex;
+    lobby::StatsResp m_report{};
+
+    std::string m_snapshotPath;
+    Clock::time_point m_nextPersist{};
+    std::vector<lobby_snapshot::Record> m_persistScratch;
+    bool m_started{ false }; // a failed start() must not overwrite the snapshot with nothing
+
+    static constexpr uint32_t kMaxWorkers = 64;
+    static constexpr std::chrono::milliseconds kWorkerMaxWait{ 1000 };
+    static constexpr std::chrono::seconds kStatsWindow{ 10 };
+    static constexpr std::chrono::seconds kPersistInterval{ 5 };
 };
\ No newline at end of file
@@ -0,0 +1,1542 @@
+#include "LobbyShard.hpp"
+#include "LobbyServer.hpp"
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+
+LobbyShard::LobbyShard(LobbyServer& server, uint32_t index)
+    : m_server(server), m_index(index) {
+}
+
+LobbyShard::~LobbyShard() {
+    for (auto& c : m_respCache) c.payload->release();
+    for (auto& c : m_combinedCache) c.payload->release();
+}
+
+bool LobbyShard::start(ISteamNetworkingSockets* iface) {
+    m_iface = iface;
+
+    m_poll = m_iface->CreatePollGroup();
+    if (m_poll == k_HSteamNetPollGroup_Invalid) {
+        std::cerr << "[Lobby] CreatePollGroup failed\n";
+        return false;
+    }
+
+    m_snapshot.publish(std::make_unique<Snapshot>(), m_server.rcu());
+    m_nextExport = Clock::now() + kExportInterval;
+    return true;
+}
+
+void LobbyShard::stop() {
+    if (!m_iface) return;
+
+    m_connToSession.forEach([&](HSteamNetConnection conn, uint64_t) {
+        m_iface->CloseConnection(conn, 0, "lobby stop", false);
+    });
+
+    flushOutbox();
+
+    {
+        std::lock_guard<std::mutex> lock(m_inboxMutex);
+        m_inbox.clear();
+        m_peerInbox.clear();
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_peerMutex);
+        m_peerOut.clear();
+    }
+    m_peerDirty.clear();
+
+    m_connToSession.clear();
+    m_budgets.clear();
+    m_subscribers.clear();
+    m_sessions.clear();
+    m_expiry.clear();
+    m_heartbeats.clear();
+    m_openByFree.clear();
+    m_migratingBySince.clear();
+    m_reservations.clear();
+    m_reserveGen = 0;
+
+    m_listEntries.clear();
+    m_listOrder.clear();
+    m_listLog.clear();
+    m_listVersion = 1;
+    m_listLogFloor = 1;
+    m_pushedVersion = 0;
+    m_publishedVersion = 0;
+    m_publishedBestFree = 0;
+    m_publishedReserveGen = 0;
+    m_stateCounts.fill(0);
+    m_listAddr6 = 0;
+    for (auto& c : m_respCache) c.payload->release();
+    m_respCache.clear();
+    for (auto& c : m_combinedCache) c.payload->release();
+    m_combinedCache.clear();
+    m_combinedVersion = 0;
+    m_combinedEntries.clear();
+    m_combinedAddrs6.clear();
+    m_combinedLog.clear();
+
+    if (m_poll != k_HSteamNetPollGroup_Invalid) {
+        m_iface->DestroyPollGroup(m_poll);
+        m_poll = k_HSteamNetPollGroup_Invalid;
+    }
+}
+
+bool LobbyShard::fillRemoteAddr(HSteamNetConnection from, SteamNetworkingIPAddr& out) {
+    SteamNetConnectionInfo_t ci{};
+    if (!m_iface->GetConnectionInfo(from, &ci)) return false;
+    if (ci.m_addrRemote.IsIPv6AllZeros()) return false;
+
+    out = ci.m_addrRemote; // IPv4 hosts come as IPv4-mapped addresses (GetIPv4() != 0)
+    return true;
+}
+
+lobby::SessionAddr6 LobbyShard::addr6(const Session& s) const {
+    lobby::SessionAddr6 a{};
+    a.sessionKey = s.sessionKey;
+    std::memcpy(a.ipv6, m_sessions.info(s).ipv6, sizeof(a.ipv6));
+    return a;
+}
+
+// IPv6 hosts' addresses go after everything else in the message, one per AddrIPv6 entry
+static void appendAddrs6(std::vector<uint8_t>& buf, const std::vector<lobby::SessionAddr6>& addrs) {
+    if (addrs.empty()) return;
+    const size_t at = buf.size();
+    buf.resize(at + addrs.size() * sizeof(lobby::SessionAddr6));
+    std::memcpy(buf.data() + at, addrs.data(), addrs.size() * sizeof(lobby::SessionAddr6));
+}
+
+// addrs: sessionKey order (snapshots, the combined list)
+static const lobby::SessionAddr6* findAddr6(const std::vector<lobby::SessionAddr6>& addrs, uint64_t key) {
+    auto it = std::lower_bound(addrs.begin(), addrs.end(), key,
+        [](const lobby::SessionAddr6& a, uint64_t k) { return a.sessionKey < k; });
+    return (it != addrs.end() && it->sessionKey == key) ? &*it : nullptr;
+}
+
+void LobbyShard::markMigrating(uint64_t sessionKey) {
+    Session* found = m_sessions.find(sessionKey);
+    if (!found) return;
+
+    Session& s = *found;
+    s.state = lobby::SessionState::Migrating;
+    s.ownerConn = k_HSteamNetConnection_Invalid;
+    s.migratingSince = Clock::now();
+    s.expiryAt = Clock::time_point{}; // drops out of the TTL heap; grace runs off m_migratingBySince
+    listUpsert(s);
+}
+
+void LobbyShard::applyPeerUpdate(const PeerUpdate& u) {
+    const uint64_t key = u.entry.sessionKey;
+
+    if (u.op == PeerUpdate::DropOrigin) {
+        std::vector<uint64_t> keys;
+        for (const Session& s : m_sessions) {
+            if (s.origin == u.origin) keys.push_back(s.sessionKey);
+        }
+        for (uint64_t k : keys) {
+            listRemove(*m_sessions.find(k));
+            m_sessions.erase(k);
+        }
+        return;
+    }
+
+    Session* found = m_sessions.find(key);
+
+    if (u.op == PeerUpdate::Remove) {
+        if (!found || found->origin != u.origin) return;
+        listRemove(*found);
+        m_sessions.erase(key);
+        return;
+    }
+
+    const bool migrating = (u.entry.state == lobby::SessionState::Migrating);
+    auto setState = [&](Session& s) {
+        if (migrating) {
+            // Grace runs here from when we heard; the peer ends it (Remove) at the latest then
+            if (s.state != lobby::SessionState::Migrating) s.migratingSince = Clock::now();
+            s.state = lobby::SessionState::Migrating;
+        }
+        else {
+            s.state = (u.entry.state == lobby::SessionState::Full) ? lobby::SessionState::Full : lobby::SessionState::Open;
+            s.migratingSince = Clock::time_point{};
+        }
+    };
+
+    if (u.op == PeerUpdate::Players) {
+        if (!found || found->origin != u.origin) return;
+        found->curPlayers = std::clamp<uint8_t>(u.entry.curPlayers, 1, found->maxPlayers);
+        setState(*found);
+        listUpsert(*found);
+        return;
+    }
+
+    // Upsert. Listed both here and by that peer means its host announced or Claimed it in both
+    // places; keep what we have unless ours is waiting for a Claim and theirs isn't.
+    if (found && found->origin != u.origin) {
+        if (found->state != lobby::SessionState::Migrating || migrating) return;
+        if (found->origin == 0) m_peerDirty.push_back(key); // ours goes: tell the peers
+    }
+
+    Session& s = m_sessions.insert(key);
+    s.origin = u.origin;
+    s.ownerConn = k_HSteamNetConnection_Invalid;
+    s.expiryAt = Clock::time_point{}; // the peer judges its TTL, not us
+    s.maxPlayers = u.entry.maxPlayers ? u.entry.maxPlayers : 3;
+    s.curPlayers = std::clamp<uint8_t>(u.entry.curPlayers, 1, s.maxPlayers);
+    setState(s);
+
+    SessionInfo& info = m_sessions.info(s);
+    info.ipv4_host_order = u.entry.ipv4_host_order;
+    info.addrFamily = (u.entry.addrFamily == lobby::AddrIPv6) ? lobby::AddrIPv6 : lobby::AddrIPv4;
+    const bool addrChanged = std::memcmp(info.ipv6, u.ipv6, sizeof(info.ipv6)) != 0;
+    std::memcpy(info.ipv6, u.ipv6, sizeof(info.ipv6));
+    info.gamePort = u.entry.gamePort;
+    info.worldSeed = u.entry.worldSeed;
+    std::memcpy(info.name, u.entry.name, sizeof(info.name));
+
+    listUpsert(s, addrChanged);
+}
+
+void LobbyShard::exportPeerChanges() {
+    if (m_peerDirty.empty()) return;
+
+    std::sort(m_peerDirty.begin(), m_peerDirty.end());
+    m_peerDirty.erase(std::unique(m_peerDirty.begin(), m_peerDirty.end()), m_peerDirty.end());
+
+    std::lock_guard<std::mutex> lock(m_peerMutex);
+    for (uint64_t key : m_peerDirty) {
+        // Whatever it is by now: listed and still ours, or gone as far as peers are concerned
+        PeerRecord r{};
+        const Session* s = m_sessions.find(key);
+        if (s && s->origin == 0 && s->listSlot != kNoListSlot) {
+            r.entry = m_listEntries[s->listSlot];
+            std::memcpy(r.ipv6, m_sessions.info(*s).ipv6, sizeof(r.ipv6));
+        }
+        else {
+            r.entry.sessionKey = key;
+            r.removed = true;
+        }
+        m_peerOut.push_back(r);
+    }
+    m_peerDirty.clear();
+}
+
+LobbyShard::Clock::time_point LobbyShard::nextDeadline() const {
+    auto at = Clock::time_point::max();
+    if (!m_expiry.empty()) at = m_expiry.front().at;
+    if (!m_migratingBySince.empty()) at = std::min(at, m_migratingBySince.begin()->first + kGraceTTL);
+    if (!m_reservations.empty()) at = std::min(at, m_reservations.front().until);
+    if (m_server.persisting()) at = std::min(at, m_nextExport);
+    return at;
+}
+
+void LobbyShard::scheduleExpiry(Session& s) {
+    const auto at = s.lastSeen + kActiveTTL;
+    if (s.expiryAt != Clock::time_point{} && s.expiryAt <= at) return; // queued entry fires first and re-arms
+
+    s.expiryAt = at;
+    m_expiry.push_back(Expiry{ at, s.sessionKey });
+    std::push_heap(m_expiry.begin(), m_expiry.end(), std::greater<>{});
+}
+
+void LobbyShard::post(HSteamNetConnection from, const void* data, uint32_t size, SteamNetworkingMicroseconds recvUsec) {
+    if (size == 0 || size > sizeof(Posted::data)) return;
+
+    Posted p{};
+    p.from = from;
+    p.recvUsec = recvUsec;
+    p.size = (uint8_t)size;
+    std::memcpy(p.data, data, size);
+    {
+        std::lock_guard<std::mutex> lock(m_inboxMutex);
+        m_inbox.push_back(p);
+        m_woken = true;
+    }
+    m_wakeCv.notify_one();
+}
+
+void LobbyShard::postConnClosed(HSteamNetConnection conn) {
+    Posted p{};
+    p.from = conn;
+    {
+        std::lock_guard<std::mutex> lock(m_inboxMutex);
+        m_inbox.push_back(p);
+        m_woken = true;
+    }
+    m_wakeCv.notify_one();
+}
+
+void LobbyShard::postPeer(const std::vector<PeerUpdate>& updates) {
+    {
+        std::lock_guard<std::mutex> lock(m_inboxMutex);
+        m_peerInbox.insert(m_peerInbox.end(), updates.begin(), updates.end());
+        m_woken = true;
+    }
+    m_wakeCv.notify_one();
+}
+
+void LobbyShard::takePeerChanges(std::vector<PeerRecord>& out) {
+    std::lock_guard<std::mutex> lock(m_peerMutex);
+    out.insert(out.end(), m_peerOut.begin(), m_peerOut.end());
+    m_peerOut.clear();
+}
+
+void LobbyShard::wake() {
+    {
+        std::lock_guard<std::mutex> lock(m_inboxMutex);
+        m_woken = true;
+    }
+    m_wakeCv.notify_one();
+}
+
+void LobbyShard::waitForWork(Clock::time_point until) {
+    std::unique_lock<std::mutex> lock(m_inboxMutex);
+    m_wakeCv.wait_until(lock, until, [&] { return m_woken; });
+    m_woken = false;
+}
+
+int LobbyShard::drainInbox() {
+    {
+        std::lock_guard<std::mutex> lock(m_inboxMutex);
+        m_inboxDrain.swap(m_inbox);
+        m_peerDrain.swap(m_peerInbox);
+    }
+
+    for (const auto& p : m_inboxDrain) {
+        if (p.size == 0) connClosed(p.from);
+        else handleMessage(p.from, p.data, p.size, p.recvUsec, true);
+    }
+    for (const auto& u : m_peerDrain) applyPeerUpdate(u);
+
+    const int n = (int)(m_inboxDrain.size() + m_peerDrain.size());
+    m_inboxDrain.clear();
+    m_peerDrain.clear();
+    return n;
+}
+
+void LobbyShard::connClosed(HSteamNetConnection conn) {
+    // If this connection owned a session, mark it migrating (grace period). It may have lost it
+    // since (TTL, a Claim, a peer's copy taking over), then there's nothing to do.
+    if (const uint64_t* owned = m_connToSession.find(conn)) {
+        const uint64_t key = *owned;
+        m_connToSession.erase(conn);
+        const Session* s = m_sessions.find(key);
+        if (s && s->ownerConn == conn) markMigrating(key);
+    }
+    m_budgets.erase(conn);
+    m_subscribers.erase(conn);
+}
+
+LobbyShard::BudgetClass LobbyShard::budgetClass(uint8_t type) {
+    switch ((lobby::Type)type) {
+    case lobby::Type::ListReq:
+    case lobby::Type::Subscribe:
+    case lobby::Type::Unsubscribe:
+        return kBudgetList;
+    case lobby::Type::Announce:
+    case lobby::Type::Claim:
+        return kBudgetAnnounce;
+    case lobby::Type::Heartbeat:
+        return kBudgetHeartbeat;
+    case lobby::Type::QuickMatch:
+        return kBudgetQuickMatch;
+    default:
+        return kBudgetOther;
+    }
+}
+
+bool LobbyShard::admit(HSteamNetConnection from, uint8_t type, SteamNetworkingMicroseconds recvUsec) {
+    // Every class refills from the one timestamp, in whole milliseconds of GNS receive time, so
+    // this costs one FlatMap probe and no clock read
+    const uint32_t nowMs = (uint32_t)(recvUsec / 1000);
+
+    bool inserted;
+    ConnBudget& b = m_budgets.insert(from, inserted);
+    if (inserted) {
+        b.refilledMs = nowMs;
+        for (size_t c = 0; c < kBudgetClasses; ++c) b.milliTokens[c] = (uint16_t)(kBudgetRules[c].burst * 1000u);
+    }
+    else if (nowMs != b.refilledMs) {
+        // Past 65 s every bucket is full anyway; the cap keeps the products in 32 bits
+        const uint32_t elapsedMs = std::min<uint32_t>(nowMs - b.refilledMs, 65535u);
+        for (size_t c = 0; c < kBudgetClasses; ++c) {
+            const uint32_t cap = kBudgetRules[c].burst * 1000u;
+            b.milliTokens[c] = (uint16_t)std::min<uint32_t>(cap, b.milliTokens[c] + elapsedMs * kBudgetRules[c].perSecond);
+        }
+        b.refilledMs = nowMs;
+    }
+
+    uint16_t& tokens = b.milliTokens[budgetClass(type)];
+    if (tokens < 1000) return false;
+    tokens -= 1000;
+    return true;
+}
+
+void LobbyShard::handleMessage(HSteamNetConnection from, const void* data, uint32_t size, SteamNetworkingMicroseconds recvUsec, bool fromInbox) {
+    if (size < 1) return;
+    const auto type = *(const lobby::Type*)data;
+
+    if (type == lobby::Type::Hello) {
+        // optional; ignore
+        return;
+    }
+
+    if (type == lobby::Type::PeerHello) {
+        // Another lobby's link to us; it wants our sessions (LobbyPeers::sync sends them). The
+        // feed is every session, uncapped and unbudgeted, so only --peer addresses may ask for it.
+        if (size < sizeof(lobby::PeerHello)) return;
+        const auto* h = (const lobby::PeerHello*)data;
+        if (h->protocol != lobby::kProtocol || !m_server.federated()) return;
+        SteamNetworkingIPAddr remote;
+        if (!fillRemoteAddr(from, remote) || !m_server.peers().isPeerAddress(remote)) {
+            ++m_pumpDropped[LobbyStats::messageSlot((uint8_t)type)];
+            return;
+        }
+        m_server.peers().addSubscriber(from);
+        return;
+    }
+
+    if (type == lobby::Type::Announce || type == lobby::Type::Claim) {
+        if (size < sizeof(lobby::Announce)) return;
+        const auto* a = (const lobby::Announce*)data;
+        if (a->protocol != lobby::kProtocol) return;
+        if (a->sessionKey == 0) return;
+
+        LobbyShard& owner = m_server.shardFor(a->sessionKey);
+        if (&owner != this) {
+            owner.post(from, data, sizeof(lobby::Announce), recvUsec);
+            return;
+        }
+
+        SteamNetworkingIPAddr remote;
+        if (!fillRemoteAddr(from, remote)) return;
+
+        const auto now = Clock::now();
+
+        const Session* existing = m_sessions.find(a->sessionKey);
+
+        // Claim rules:
+        // - if session exists and is Migrating: accept first claim, replace ownerConn
+        // - if session exists and is Open/Full: ignore Claim (prevents hijack)
+        // - Announce always creates/updates (host normal behavior)
+        if (type == lobby::Type::Claim) {
+            if (!existing) return;
+            if (existing->state != lobby::SessionState::Migrating) return;
+        }
+
+        Session& s = m_sessions.insert(a->sessionKey);
+        s.ownerConn = from;
+        s.origin = 0; // a peer's copy (Claimed here) is ours from now on
+        s.maxPlayers = a->maxPlayers ? a->maxPlayers : 3;
+
+        SessionInfo& info = m_sessions.info(s);
+        info.ipv4_host_order = remote.GetIPv4();
+        info.addrFamily = info.ipv4_host_order ? lobby::AddrIPv4 : lobby::AddrIPv6;
+        uint8_t ipv6[16]{};
+        if (info.addrFamily == lobby::AddrIPv6) std::memcpy(ipv6, remote.m_ipv6, sizeof(ipv6));
+        const bool addrChanged = std::memcmp(info.ipv6, ipv6, sizeof(ipv6)) != 0;
+        std::memcpy(info.ipv6, ipv6, sizeof(ipv6));
+        info.gamePort = a->gamePort;
+        info.worldSeed = a->worldSeed;
+        std::memcpy(info.name, a->name, sizeof(info.name));
+
+        // On announce/claim, reset timers
+        s.lastSeen = now;
+        s.migratingSince = Clock::time_point{};
+
+        // State computed from curPlayers unless migrating
+        if (s.curPlayers >= s.maxPlayers) s.state = lobby::SessionState::Full;
+        else s.state = lobby::SessionState::Open;
+
+        scheduleExpiry(s);
+        listUpsert(s, addrChanged);
+        if (m_server.federated()) m_peerDirty.push_back(s.sessionKey); // taking over a peer's copy may not change the entry
+        m_connToSession[from] = a->sessionKey;
+        return;
+    }
+
+    if (type == lobby::Type::Heartbeat) {
+        if (size < sizeof(lobby::Heartbeat)) return;
+        const auto* hb = (const lobby::Heartbeat*)data;
+        if (hb->sessionKey == 0) return;
+
+        LobbyShard& owner = m_server.shardFor(hb->sessionKey);
+        if (&owner != this) {
+            owner.post(from, data, sizeof(lobby::Heartbeat), recvUsec);
+            return;
+        }
+
+        // Applied with the rest of this pump's heartbeats (applyHeartbeats)
+        m_heartbeats.push_back(PendingHeartbeat{ hb->sessionKey, (uint32_t)m_heartbeats.size(), from, hb->curPlayers });
+        return;
+    }
+
+    if (type == lobby::Type::ListReq) {
+        if (size < sizeof(lobby::ListReq)) return;
+        lobby::ListReq lr{};
+        std::memcpy(&lr, data, sizeof(lr));
+        if (lr.protocol != lobby::kProtocol) return;
+
+        if (lr.pageSize && sharded()) sendPageFromSnapshots(from, lr, recvUsec);
+        else if (lr.pageSize) sendPage(from, lr, recvUsec);
+        else sendList(from, lr.listEpoch, lr.listVersion, recvUsec);
+        return;
+    }
+
+    if (type == lobby::Type::Subscribe) {
+        if (size < sizeof(lobby::ListReq)) return;
+        const auto* lr = (const lobby::ListReq*)data;
+        if (lr->protocol != lobby::kProtocol) return;
+
+        // Bring the subscriber up to date now; later changes are pushed at the end of each pump
+        m_subscribers[from] = sendList(from, lr->listEpoch, lr->listVersion, recvUsec);
+        return;
+    }
+
+    if (type == lobby::Type::Unsubscribe) {
+        m_subscribers.erase(from);
+        return;
+    }
+
+    if (type == lobby::Type::StatsReq) {
+        if (size < sizeof(lobby::StatsReq)) return;
+        const auto* sr = (const lobby::StatsReq*)data;
+        if (sr->protocol != lobby::kProtocol) return;
+
+        // Built once per window by the server; answering is a copy
+        const lobby::StatsResp resp = m_server.statsReport();
+        std::vector<uint8_t> bytes(sizeof(resp));
+        std::memcpy(bytes.data(), &resp, sizeof(resp));
+        queueBytes(from, std::move(bytes), 0);
+        return;
+    }
+
+    if (type == lobby::Type::QuickMatch) {
+        if (size < sizeof(lobby::QuickMatch)) return;
+        const auto* qm = (const lobby::QuickMatch*)data;
+        if (qm->protocol != lobby::kProtocol) return;
+
+        // The shard holding the best candidate picks (and reserves) from its live state and
+        // answers the requester directly
+        if (!fromInbox && sharded()) {
+            LobbyShard* best = quickMatchShard();
+            if (best != this) {
+                best->post(from, data, sizeof(lobby::QuickMatch), recvUsec);
+                return;
+            }
+        }
+        sendQuickMatch(from, qm->reserveSlot != 0);
+        return;
+    }
+}
+
+void LobbyShard::applyHeartbeats() {
+    if (m_heartbeats.empty()) return;
+
+    const auto now = Clock::now();
+    std::sort(m_heartbeats.begin(), m_heartbeats.end());
+
+    const size_t n = m_heartbeats.size();
+    for (size_t i = 0; i < n;) {
+        const uint64_t key = m_heartbeats[i].sessionKey;
+        size_t end = i + 1;
+        while (end < n && m_heartbeats[end].sessionKey == key) ++end;
+
+        Session* found = m_sessions.find(key);
+        if (!found || found->state == lobby::SessionState::Migrating) {
+            i = end;
+            continue;
+        }
+        Session& s = *found;
+
+        // Only the current owner conn counts; its latest heartbeat wins
+        const PendingHeartbeat* hb = nullptr;
+        for (size_t j = i; j < end; ++j) {
+            if (m_heartbeats[j].from == s.ownerConn) hb = &m_heartbeats[j];
+        }
+        i = end;
+        if (!hb) continue;
+
+        const uint8_t prevPlayers = s.curPlayers;
+        const auto prevState = s.state;
+
+        s.curPlayers = (uint8_t)std::clamp<uint16_t>(hb->curPlayers, 1, s.maxPlayers);
+        s.lastSeen = now;
+        s.state = (s.curPlayers >= s.maxPlayers) ? lobby::SessionState::Full : lobby::SessionState::Open;
+
+        // Most heartbeats change nothing a browser can see
+        if (s.curPlayers != prevPlayers || s.state != prevState) listUpsert(s);
+    }
+
+    m_heartbeats.clear();
+}
+
+void LobbyShard::cleanupExpired() {
+    const auto now = Clock::now();
+    bool ran = false;
+
+    // A heartbeat still waiting in this pump's batch has to count before any TTL is judged
+    if (!m_heartbeats.empty() && !m_expiry.empty() && m_expiry.front().at < now) applyHeartbeats();
+
+    while (!m_expiry.empty() && m_expiry.front().at < now) {
+        ran = true;
+        std::pop_heap(m_expiry.begin(), m_expiry.end(), std::greater<>{});
+        const Expiry e = m_expiry.back();
+        m_expiry.pop_back();
+
+        Session* found = m_sessions.find(e.sessionKey);
+        if (!found) continue;
+
+        Session& s = *found;
+        if (s.expiryAt != e.at) continue; // stale, a sooner entry superseded it
+        s.expiryAt = Clock::time_point{};
+
+        if (s.state == lobby::SessionState::Migrating) continue;
+
+        // Heartbeat/announce since this was queued: just re-arm at the real deadline
+        if (now <= s.lastSeen + kActiveTTL) {
+            scheduleExpiry(s);
+            continue;
+        }
+
+        // TTL exceeded: mark migrating (grace starts now)
+        markMigrating(s.sessionKey);
+    }
+
+    // Lapsed QuickMatch holds give their slot back. A joiner that made it in already shows in
+    // curPlayers, so until then the session just advertises one slot fewer than it has.
+    while (!m_reservations.empty() && m_reservations.front().until < now) {
+        ran = true;
+        const uint64_t key = m_reservations.front().sessionKey;
+        m_reservations.pop_front();
+
+        Session* s = m_sessions.find(key);
+        if (!s || s->reservedSlots == 0) continue;
+        --s->reservedSlots;
+        ++m_reserveGen;
+        indexUpdate(*s);
+    }
+
+    // Migrating: grace exceeded, delete (oldest first, stops at the first one still in grace)
+    while (!m_migratingBySince.empty() && m_migratingBySince.begin()->first + kGraceTTL < now) {
+        ran = true;
+        const uint64_t key = m_migratingBySince.begin()->second;
+        Session* s = m_sessions.find(key);
+        if (!s) {
+            m_migratingBySince.erase(m_migratingBySince.begin());
+            continue;
+        }
+
+        listRemove(*s);
+        m_sessions.erase(key);
+    }
+
+    // Most calls find nothing due; only passes that did something are timed
+    if (ran) {
+        m_pumpCleanup += Clock::now() - now;
+        m_pumpCleanupRan = true;
+    }
+}
+
+void LobbyShard::listUpsert(Session& s, bool addrChanged) {
+    const SessionInfo& info = m_sessions.info(s);
+
+    lobby::SessionEntry e{};
+    e.sessionKey = s.sessionKey;
+    e.ipv4_host_order = info.ipv4_host_order;
+    e.gamePort = info.gamePort;
+    e.curPlayers = s.curPlayers;
+    e.maxPlayers = s.maxPlayers;
+    e.worldSeed = info.worldSeed;
+    e.state = s.state;
+    e.addrFamily = info.addrFamily;
+    std::memcpy(e.name, info.name, sizeof(e.name));
+
+    indexUpdate(s);
+
+    if (s.listSlot == kNoListSlot) {
+        s.listSlot = (uint32_t)m_listEntries.size();
+        m_listEntries.push_back(e);
+        listOrderInsert(s.sessionKey);
+        ++m_stateCounts[(size_t)e.state];
+        if (e.addrFamily == lobby::AddrIPv6) ++m_listAddr6;
+    }
+    else {
+        auto& cur = m_listEntries[s.listSlot];
+        if (!addrChanged && std::memcmp(&cur, &e, sizeof(e)) == 0) return; // e.g. re-announce with same info
+        --m_stateCounts[(size_t)cur.state];
+        ++m_stateCounts[(size_t)e.state];
+        m_listAddr6 += (e.addrFamily == lobby::AddrIPv6) - (cur.addrFamily == lobby::AddrIPv6);
+        cur = e;
+    }
+
+    if (s.origin == 0 && m_server.federated()) m_peerDirty.push_back(s.sessionKey);
+    listChanged(s.sessionKey);
+}
+
+void LobbyShard::listRemove(Session& s) {
+    indexRemove(s);
+    if (s.listSlot == kNoListSlot) return;
+    --m_stateCounts[(size_t)m_listEntries[s.listSlot].state];
+    if (m_listEntries[s.listSlot].addrFamily == lobby::AddrIPv6) --m_listAddr6;
+
+    // swap-with-last keeps the array dense; fix up the moved session's slot
+    const uint32_t last = (uint32_t)m_listEntries.size() - 1;
+    if (s.listSlot != last) {
+        m_listEntries[s.listSlot] = m_listEntries[last];
+        Session* moved = m_sessions.find(m_listEntries[s.listSlot].sessionKey);
+        if (moved) moved->listSlot = s.listSlot;
+    }
+    m_listEntries.pop_back();
+    listOrderErase(s.sessionKey);
+
+    if (s.origin == 0 && m_server.federated()) m_peerDirty.push_back(s.sessionKey);
+    listChanged(s.sessionKey);
+}
+
+void LobbyShard::indexUpdate(Session& s) {
+    const int used = s.curPlayers + s.reservedSlots;
+    const uint8_t freeSlots = (s.state == lobby::SessionState::Open && s.maxPlayers > used) ? (uint8_t)(s.maxPlayers - used) : 0;
+    if (freeSlots != s.openBucket) {
+        if (s.openBucket) m_openByFree[s.openBucket].erase(s.sessionKey);
+        if (freeSlots) {
+            if (m_openByFree.size() <= freeSlots) m_openByFree.resize((size_t)freeSlots + 1);
+            m_openByFree[freeSlots].insert(s.sessionKey);
+        }
+        s.openBucket = freeSlots;
+    }
+
+    const auto since = (s.state == lobby::SessionState::Migrating) ? s.migratingSince : Clock::time_point{};
+    if (since != s.indexedSince) {
+        if (s.indexedSince != Clock::time_point{}) m_migratingBySince.erase({ s.indexedSince, s.sessionKey });
+        if (since != Clock::time_point{}) m_migratingBySince.insert({ since, s.sessionKey });
+        s.indexedSince = since;
+    }
+}
+
+void LobbyShard::indexRemove(Session& s) {
+    if (s.openBucket) m_openByFree[s.openBucket].erase(s.sessionKey);
+    if (s.indexedSince != Clock::time_point{}) m_migratingBySince.erase({ s.indexedSince, s.sessionKey });
+    s.openBucket = 0;
+    s.indexedSince = Clock::time_point{};
+}
+
+void LobbyShard::listChanged(uint64_t sessionKey) {
+    ++m_listVersion;
+    // No client holds a session outside the window; the version still moves for snapshots/export
+    if (!inListWindow(sessionKey)) return;
+
+    if (m_listLog.size() >= kListLogCap) {
+        m_listLogFloor = m_listLog.front().version;
+        m_listLog.pop_front();
+    }
+    m_listLog.push_back(ListChange{ m_listVersion, sessionKey });
+}
+
+// A key that lands inside a full window pushes its last key out; logging that key makes the
+// next Delta remove it, so delta-built lists keep matching a fresh Full
+void LobbyShard::listOrderInsert(uint64_t sessionKey) {
+    const auto it = m_listOrder.insert(sessionKey).first;
+    if (m_listOrder.size() <= kMaxListEntries) {
+        m_windowLast = std::prev(m_listOrder.end());
+        return;
+    }
+    if (*it > *m_windowLast) return;
+    listChanged(*m_windowLast);
+    --m_windowLast;
+}
+
+// ...and one leaving it pulls the first key past the window in
+void LobbyShard::listOrderErase(uint64_t sessionKey) {
+    if (m_listOrder.size() > kMaxListEntries && sessionKey <= *m_windowLast) {
+        ++m_windowLast;
+        listChanged(*m_windowLast);
+    }
+    m_listOrder.erase(sessionKey);
+    if (!m_listOrder.empty() && m_listOrder.size() <= kMaxListEntries) m_windowLast = std::prev(m_listOrder.end());
+}
+
+bool LobbyShard::inListWindow(uint64_t sessionKey) const {
+    return m_listOrder.size() <= kMaxListEntries || sessionKey <= *m_windowLast;
+}
+
+lobby::ListRespHdr LobbyShard::listHeader(lobby::ListKind kind, uint32_t baseVersion) const {
+    lobby::ListRespHdr hdr{};
+    hdr.type = lobby::Type::ListResp;
+    hdr.kind = kind;
+    hdr.listEpoch = m_server.listEpoch();
+    hdr.baseVersion = baseVersion;
+    hdr.listVersion = m_listVersion;
+    return hdr;
+}
+
+std::vector<uint8_t> LobbyShard::buildFullList() const {
+    lobby::ListRespHdr hdr = listHeader(lobby::ListKind::Full, 0);
+    hdr.count = (uint16_t)std::min(m_listEntries.size(), kMaxListEntries);
+
+    const size_t entryBytes = (size_t)hdr.count * sizeof(lobby::SessionEntry);
+    std::vector<uint8_t> buf(sizeof(hdr) + entryBytes);
+
+    std::memcpy(buf.data(), &hdr, sizeof(hdr));
+    auto* entries = (lobby::SessionEntry*)(buf.data() + sizeof(hdr));
+    if (m_listEntries.size() <= kMaxListEntries) {
+        if (hdr.count) std::memcpy(entries, m_listEntries.data(), entryBytes);
+    }
+    else {
+        // Only the window fits: the lowest keys, the same ones Deltas are cut to
+        auto it = m_listOrder.begin();
+        for (uint16_t i = 0; i < hdr.count; ++it) {
+            const Session* s = m_sessions.find(*it);
+            if (s && s->listSlot != kNoListSlot) entries[i++] = m_listEntries[s->listSlot];
+        }
+    }
+
+    if (m_listAddr6) {
+        std::vector<lobby::SessionAddr6> addrs;
+        for (uint16_t i = 0; i < hdr.count; ++i) {
+            if (entries[i].addrFamily != lobby::AddrIPv6) continue;
+            if (const Session* s = m_sessions.find(entries[i].sessionKey)) addrs.push_back(addr6(*s));
+        }
+        appendAddrs6(buf, addrs);
+    }
+    return buf;
+}
+
+std::vector<uint8_t> LobbyShard::buildListDelta(uint32_t baseVersion) {
+    // Every key touched after baseVersion; its current entry (or absence) is the delta
+    m_deltaKeys.clear();
+    auto it = std::upper_bound(m_listLog.begin(), m_listLog.end(), baseVersion,
+        [](uint32_t v, const ListChange& c) { return v < c.version; });
+    for (; it != m_listLog.end(); ++it) m_deltaKeys.push_back(it->sessionKey);
+
+    std::sort(m_deltaKeys.begin(), m_deltaKeys.end());
+    m_deltaKeys.erase(std::unique(m_deltaKeys.begin(), m_deltaKeys.end()), m_deltaKeys.end());
+
+    std::vector<const lobby::SessionEntry*> upserts;
+    std::vector<uint64_t> removed;
+    std::vector<lobby::SessionAddr6> addrs;
+    for (uint64_t key : m_deltaKeys) {
+        const Session* s = m_sessions.find(key);
+        if (s && s->listSlot != kNoListSlot && inListWindow(key)) {
+            upserts.push_back(&m_listEntries[s->listSlot]);
+            if (upserts.back()->addrFamily == lobby::AddrIPv6) addrs.push_back(addr6(*s));
+        }
+        else {
+            removed.push_back(key);
+        }
+    }
+
+    const size_t bytes = sizeof(lobby::ListRespHdr) + upserts.size() * sizeof(lobby::SessionEntry) + removed.size() * sizeof(uint64_t);
+    const size_t fullBytes = sizeof(lobby::ListRespHdr) + std::min(m_listEntries.size(), kMaxListEntries) * sizeof(lobby::SessionEntry);
+    if (bytes >= fullBytes || upserts.size() > kMaxListEntries || removed.size() > 0xFFFF) return buildFullList();
+
+    lobby::ListRespHdr hdr = listHeader(lobby::ListKind::Delta, baseVersion);
+    hdr.count = (uint16_t)upserts.size();
+    hdr.removedCount = (uint16_t)removed.size();
+
+    std::vector<uint8_t> buf(bytes);
+    uint8_t* p = buf.data();
+    std::memcpy(p, &hdr, sizeof(hdr));
+    p += sizeof(hdr);
+    for (const auto* e : upserts) {
+        std::memcpy(p, e, sizeof(*e));
+        p += sizeof(*e);
+    }
+    if (!removed.empty()) std::memcpy(p, removed.data(), removed.size() * sizeof(uint64_t));
+    appendAddrs6(buf, addrs);
+    return buf;
+}
+
+SharedPayload* LobbyShard::listResponse(uint32_t haveEpoch, uint32_t haveVersion) {
+    if (m_respCacheVersion != m_listVersion) {
+        // Messages still in flight keep their own references to the old payloads
+        for (auto& c : m_respCache) c.payload->release();
+        m_respCache.clear();
+        m_respCacheVersion = m_listVersion;
+    }
+
+    // Anything we can't diff against (other epoch, too old, nonsense) gets the full list
+    uint32_t base = 0;
+    if (haveEpoch == m_server.listEpoch() && haveVersion >= m_listLogFloor && haveVersion <= m_listVersion) base = haveVersion;
+
+    for (auto& c : m_respCache) {
+        if (c.haveVersion == base) return c.payload;
+    }
+
+    std::vector<uint8_t> bytes;
+    if (base == 0) {
+        bytes = buildFullList();
+    }
+    else if (base == m_listVersion) {
+        const lobby::ListRespHdr hdr = listHeader(lobby::ListKind::Unchanged, base);
+        bytes.resize(sizeof(hdr));
+        std::memcpy(bytes.data(), &hdr, sizeof(hdr));
+    }
+    else {
+        bytes = buildListDelta(base);
+    }
+
+    if (m_respCache.size() >= kRespCacheCap) {
+        m_respCache.front().payload->release();
+        m_respCache.erase(m_respCache.begin());
+    }
+    m_respCache.push_back(CachedResp{ base, SharedPayload::create(std::move(bytes)) });
+    return m_respCache.back().payload;
+}
+
+uint32_t LobbyShard::sendList(HSteamNetConnection to, uint32_t haveEpoch, uint32_t haveVersion, SteamNetworkingMicroseconds recvUsec) {
+    cleanupExpired();
+
+    SharedPayload* payload = nullptr;
+    uint32_t version = m_listVersion;
+    if (sharded()) {
+        version = loadSnapshots();
+        payload = combinedListResponse(haveEpoch, haveVersion);
+    }
+    else {
+        payload = listResponse(haveEpoch, haveVersion);
+    }
+
+    // Requesters at the same version share one payload until the list changes; no per-request copy
+    m_outbox.push_back(payload->makeMessage(to, k_nSteamNetworkingSend_Reliable));
+    m_outboxRecvUsec.push_back(recvUsec);
+    return version;
+}
+
+// reservedSlots: QuickMatch holds count as taken, as in the free-slot buckets
+static bool pageFilterMatches(const lobby::SessionEntry& e, uint8_t reservedSlots, const lobby::ListReq& req, size_t prefixLen) {
+    const uint8_t f = req.filterFlags;
+    if ((f & lobby::FilterOpenOnly) && e.state != lobby::SessionState::Open) return false;
+    if ((f & lobby::FilterMinFree) && e.curPlayers + reservedSlots + req.minFreeSlots > e.maxPlayers) return false;
+    if ((f & lobby::FilterWorldSeed) && e.worldSeed != req.worldSeed) return false;
+    if ((f & lobby::FilterName) && std::strncmp(e.name, req.namePrefix, prefixLen) != 0) return false;
+    return true;
+}
+
+void LobbyShard::sendPage(HSteamNetConnection to, const lobby::ListReq& req, SteamNetworkingMicroseconds recvUsec) {
+    cleanupExpired();
+
+    const size_t want = std::min<size_t>(req.pageSize, lobby::kMaxPageEntries);
+    const size_t prefixLen = strnlen(req.namePrefix, sizeof(req.namePrefix));
+
+    std::vector<uint8_t> buf(sizeof(lobby::ListRespHdr) + want * sizeof(lobby::SessionEntry));
+    uint8_t* out = buf.data() + sizeof(lobby::ListRespHdr);
+
+    // Key-ordered sources to walk: the Open free-slot buckets that satisfy the filter (merged), or
+    // every listed session. Either way pages come out in sessionKey order, so the cursor is a key.
+    using KeyIter = std::set<uint64_t>::const_iterator;
+    std::vector<std::pair<KeyIter, KeyIter>> sources;
+    if (req.filterFlags & lobby::FilterOpenOnly) {
+        const size_t minFree = (req.filterFlags & lobby::FilterMinFree) ? std::max<size_t>(req.minFreeSlots, 1) : 1;
+        for (size_t b = minFree; b < m_openByFree.size(); ++b) {
+            if (!m_openByFree[b].empty()) sources.emplace_back(m_openByFree[b].upper_bound(req.cursor), m_openByFree[b].cend());
+        }
+    }
+    else {
+        sources.emplace_back(m_listOrder.upper_bound(req.cursor), m_listOrder.cend());
+    }
+
+    // Resume after the cursor key. The scan is bounded, so a sparse filter can return a short
+    // (even empty) page with a cursor; the client keeps paging until nextCursor is 0.
+    std::vector<lobby::SessionAddr6> addrs;
+    uint16_t count = 0;
+    size_t scanned = 0;
+    uint64_t lastKey = req.cursor;
+    uint64_t nextCursor = 0;
+    for (;;) {
+        std::pair<KeyIter, KeyIter>* src = nullptr;
+        for (auto& r : sources) {
+            if (r.first != r.second && (!src || *r.first < *src->first)) src = &r;
+        }
+        if (!src) break;
+
+        if (count == want || scanned == kMaxPageScan) {
+            nextCursor = lastKey;
+            break;
+        }
+        ++scanned;
+        lastKey = *src->first;
+        const auto it = src->first++;
+
+        const Session* s = m_sessions.find(*it);
+        if (!s || s->listSlot == kNoListSlot) continue;
+
+        const auto& e = m_listEntries[s->listSlot];
+        if (!pageFilterMatches(e, s->reservedSlots, req, prefixLen)) continue;
+
+        std::memcpy(out, &e, sizeof(e));
+        out += sizeof(e);
+        ++count;
+        if (e.addrFamily == lobby::AddrIPv6) addrs.push_back(addr6(*s));
+    }
+
+    lobby::ListRespHdr hdr = listHeader(lobby::ListKind::Page, 0);
+    hdr.count = count;
+    hdr.nextCursor = nextCursor;
+    std::memcpy(buf.data(), &hdr, sizeof(hdr));
+    buf.resize(sizeof(hdr) + (size_t)count * sizeof(lobby::SessionEntry));
+    appendAddrs6(buf, addrs);
+
+    // Pages depend on the request, so they aren't cached
+    queueBytes(to, std::move(buf), recvUsec);
+}
+
+void LobbyShard::sendQuickMatch(HSteamNetConnection to, bool reserve) {
+    cleanupExpired();
+
+    lobby::QuickMatchResp resp{};
+    resp.type = lobby::Type::QuickMatchResp;
+    std::vector<lobby::SessionAddr6> addrs;
+
+    // Fewest unreserved free slots first = most players but not full. Reserving moves the session
+    // down a bucket, so a burst of quick-matchers fills one session before spilling to the next.
+    for (size_t b = 1; b < m_openByFree.size(); ++b) {
+        if (m_openByFree[b].empty()) continue;
+
+        Session* found = m_sessions.find(*m_openByFree[b].begin());
+        if (!found || found->listSlot == kNoListSlot) continue;
+
+        Session& s = *found;
+        resp.found = 1;
+        resp.entry = m_listEntries[s.listSlot];
+        if (resp.entry.addrFamily == lobby::AddrIPv6) addrs.push_back(addr6(s));
+
+        if (reserve) {
+            ++s.reservedSlots;
+            ++m_reserveGen;
+            m_reservations.push_back(Reservation{ Clock::now() + kReserveTTL, s.sessionKey });
+            indexUpdate(s);
+            resp.reservedMs = (uint16_t)std::chrono::duration_cast<std::chrono::milliseconds>(kReserveTTL).count();
+        }
+        break;
+    }
+
+    std::vector<uint8_t> bytes(sizeof(resp));
+    std::memcpy(bytes.data(), &resp, sizeof(resp));
+    appendAddrs6(bytes, addrs);
+    queueBytes(to, std::move(bytes), 0);
+}
+
+void LobbyShard::queueBytes(HSteamNetConnection to, std::vector<uint8_t>&& bytes, SteamNetworkingMicroseconds recvUsec) {
+    // One-off payload; it lives as long as its message
+    SharedPayload* payload = SharedPayload::create(std::move(bytes));
+    m_outbox.push_back(payload->makeMessage(to, k_nSteamNetworkingSend_Reliable));
+    m_outboxRecvUsec.push_back(recvUsec);
+    payload->release();
+}
+
+void LobbyShard::pushToSubscribers() {
+    if (m_subscribers.empty()) return;
+
+    const uint32_t version = sharded() ? loadSnapshots() : m_listVersion;
+    if (m_pushedVersion == version) return; // nothing changed; everyone is current
+    m_pushedVersion = version;
+
+    for (auto& kv : m_subscribers) {
+        if (kv.second == version) continue;
+
+        // Subscribers all saw the previous pump's version, so this is normally one shared Delta
+        SharedPayload* payload = sharded() ? combinedListResponse(combinedEpoch(), kv.second) : listResponse(m_server.listEpoch(), kv.second);
+        m_outbox.push_back(payload->makeMessage(kv.first, k_nSteamNetworkingSend_Reliable));
+        m_outboxRecvUsec.push_back(0);
+        kv.second = version;
+    }
+}
+
+bool LobbyShard::sharded() const {
+    return m_server.shardCount() > 1;
+}
+
+uint32_t LobbyShard::combinedEpoch() const {
+    // A client that reconnects onto another shard holds a sum this one never served; Full it is
+    return m_server.listEpoch() + m_index;
+}
+
+void LobbyShard::publishSnapshot() {
+    uint8_t bestFree = 0;
+    for (size_t b = 1; b < m_openByFree.size(); ++b) {
+        if (!m_openByFree[b].empty()) { bestFree = (uint8_t)b; break; }
+    }
+    // Reservations move bestFree and the page filter without touching the list version
+    if (m_publishedVersion == m_listVersion && m_publishedBestFree == bestFree && m_publishedReserveGen == m_reserveGen) return;
+    m_publishedVersion = m_listVersion;
+    m_publishedBestFree = bestFree;
+    m_publishedReserveGen = m_reserveGen;
+
+    auto snap = std::make_unique<Snapshot>();
+    snap->version = m_listVersion;
+    snap->bestFree = bestFree;
+    snap->entries.reserve(m_listOrder.size());
+    snap->reserved.reserve(m_listOrder.size());
+    for (uint64_t key : m_listOrder) {
+        const Session* s = m_sessions.find(key);
+        if (!s || s->listSlot == kNoListSlot) continue;
+        snap->entries.push_back(m_listEntries[s->listSlot]);
+        snap->reserved.push_back(s->reservedSlots);
+        if (snap->entries.back().addrFamily == lobby::AddrIPv6) snap->addrs6.push_back(addr6(*s));
+    }
+
+    // Readers on other workers keep the old one until their next quiescent state; never waits
+    m_snapshot.publish(std::move(snap), m_server.rcu());
+
+    // Other shards' subscribers need to hear about it
+    for (uint32_t i = 0; i < m_server.shardCount(); ++i) {
+        if (i != m_index) m_server.shard(i).wake();
+    }
+}
+
+uint32_t LobbyShard::loadSnapshots() {
+    const uint32_t n = m_server.shardCount();
+    m_snaps.resize(n);
+
+    // Each shard version only grows, and this thread reads them in order, so the sum identifies
+    // what this shard's clients were sent
+    uint32_t version = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        m_snaps[i] = m_server.shard(i).snapshot();
+        version += m_snaps[i]->version;
+    }
+    m_snapsVersion = version;
+    return version;
+}
+
+SharedPayload* LobbyShard::combinedListResponse(uint32_t haveEpoch, uint32_t haveVersion) {
+    if (m_combinedVersion != m_snapsVersion) advanceCombined();
+
+    // As listResponse: anything we can't diff against gets the full list
+    uint32_t base = 0;
+    if (haveEpoch == combinedEpoch() && haveVersion >= m_combinedLogFloor && haveVersion <= m_combinedVersion) base = haveVersion;
+
+    for (auto& c : m_combinedCache) {
+        if (c.haveVersion == base) return c.payload;
+    }
+
+    std::vector<uint8_t> bytes;
+    if (base == m_combinedVersion) {
+        lobby::ListRespHdr hdr{};
+        hdr.type = lobby::Type::ListResp;
+        hdr.kind = lobby::ListKind::Unchanged;
+        hdr.listEpoch = combinedEpoch();
+        hdr.baseVersion = base;
+        hdr.listVersion = m_combinedVersion;
+        bytes.resize(sizeof(hdr));
+        std::memcpy(bytes.data(), &hdr, sizeof(hdr));
+    }
+    else {
+        bytes = buildCombinedList(base);
+    }
+
+    if (m_combinedCache.size() >= kRespCacheCap) {
+        m_combinedCache.front().payload->release();
+        m_combinedCache.erase(m_combinedCache.begin());
+    }
+    m_combinedCache.push_back(CachedResp{ base, SharedPayload::create(std::move(bytes)) });
+    return m_combinedCache.back().payload;
+}
+
+void LobbyShard::advanceCombined() {
+    std::vector<lobby::SessionEntry> entries;
+    std::vector<lobby::SessionAddr6> addrs;
+    mergeSnapshots(entries, addrs);
+
+    // Both lists are in key order: walk them together and log every key added, dropped or changed.
+    // Clients only ever hold versions served from here, so these diffs chain into any delta.
+    if (m_combinedVersion == 0) m_combinedLogFloor = m_snapsVersion;
+    size_t i = 0, j = 0;
+    while (i < m_combinedEntries.size() || j < entries.size()) {
+        uint64_t key;
+        if (j == entries.size() || (i < m_combinedEntries.size() && m_combinedEntries[i].sessionKey < entries[j].sessionKey)) {
+            key = m_combinedEntries[i++].sessionKey;
+        }
+        else if (i == m_combinedEntries.size() || entries[j].sessionKey < m_combinedEntries[i].sessionKey) {
+            key = entries[j++].sessionKey;
+        }
+        else {
+            const lobby::SessionEntry& was = m_combinedEntries[i++];
+            const lobby::SessionEntry& now = entries[j++];
+            key = now.sessionKey;
+            bool same = std::memcmp(&was, &now, sizeof(now)) == 0;
+            if (same && now.addrFamily == lobby::AddrIPv6) {
+                const auto* a = findAddr6(m_combinedAddrs6, key);
+                const auto* b = findAddr6(addrs, key);
+                same = a && b && std::memcmp(a, b, sizeof(*a)) == 0;
+            }
+            if (same) continue;
+        }
+
+        if (m_combinedLog.size() >= kListLogCap) {
+            m_combinedLogFloor = m_combinedLog.front().version;
+            m_combinedLog.pop_front();
+        }
+        m_combinedLog.push_back(ListChange{ m_snapsVersion, key });
+    }
+
+    m_combinedEntries.swap(entries);
+    m_combinedAddrs6.swap(addrs);
+    m_combinedVersion = m_snapsVersion;
+
+    // Messages still in flight keep their own references to the old payloads
+    for (auto& c : m_combinedCache) c.payload->release();
+    m_combinedCache.clear();
+}
+
+std::vector<uint8_t> LobbyShard::buildCombinedList(uint32_t baseVersion) {
+    std::vector<const lobby::SessionEntry*> upserts;
+    std::vector<uint64_t> removed;
+    std::vector<lobby::SessionAddr6> addrs;
+
+    if (baseVersion) {
+        // Every key logged after baseVersion; its current entry (or absence) is the delta
+        m_deltaKeys.clear();
+        auto it = std::upper_bound(m_combinedLog.begin(), m_combinedLog.end(), baseVersion,
+            [](uint32_t v, const ListChange& c) { return v < c.version; });
+        for (; it != m_combinedLog.end(); ++it) m_deltaKeys.push_back(it->sessionKey);
+
+        std::sort(m_deltaKeys.begin(), m_deltaKeys.end());
+        m_deltaKeys.erase(std::unique(m_deltaKeys.begin(), m_deltaKeys.end()), m_deltaKeys.end());
+
+        for (uint64_t key : m_deltaKeys) {
+            auto e = std::lower_bound(m_combinedEntries.begin(), m_combinedEntries.end(), key,
+                [](const lobby::SessionEntry& x, uint64_t k) { return x.sessionKey < k; });
+            if (e != m_combinedEntries.end() && e->sessionKey == key) {
+                upserts.push_back(&*e);
+                if (e->addrFamily != lobby::AddrIPv6) continue;
+                if (const auto* a = findAddr6(m_combinedAddrs6, key)) addrs.push_back(*a);
+            }
+            else {
+                removed.push_back(key);
+            }
+        }
+
+        const size_t bytes = upserts.size() * sizeof(lobby::SessionEntry) + removed.size() * sizeof(uint64_t);
+        if (bytes >= m_combinedEntries.size() * sizeof(lobby::SessionEntry) || removed.size() > 0xFFFF) baseVersion = 0;
+    }
+
+    if (!baseVersion) {
+        upserts.clear();
+        removed.clear();
+        for (const auto& e : m_combinedEntries) upserts.push_back(&e);
+        addrs = m_combinedAddrs6;
+    }
+
+    lobby::ListRespHdr hdr{};
+    hdr.type = lobby::Type::ListResp;
+    hdr.kind = baseVersion ? lobby::ListKind::Delta : lobby::ListKind::Full;
+    hdr.count = (uint16_t)upserts.size();
+    hdr.removedCount = (uint16_t)removed.size();
+    hdr.listEpoch = combinedEpoch();
+    hdr.baseVersion = baseVersion;
+    hdr.listVersion = m_combinedVersion;
+
+    std::vector<uint8_t> buf(sizeof(hdr) + upserts.size() * sizeof(lobby::SessionEntry) + removed.size() * sizeof(uint64_t));
+    uint8_t* p = buf.data();
+    std::memcpy(p, &hdr, sizeof(hdr));
+    p += sizeof(hdr);
+    for (const auto* e : upserts) {
+        std::memcpy(p, e, sizeof(*e));
+        p += sizeof(*e);
+    }
+    if (!removed.empty()) std::memcpy(p, removed.data(), removed.size() * sizeof(uint64_t));
+    appendAddrs6(buf, addrs);
+    return buf;
+}
+
+void LobbyShard::mergeSnapshots(std::vector<lobby::SessionEntry>& entries, std::vector<lobby::SessionAddr6>& addrs) const {
+    // Same window as one shard's list: the kMaxListEntries lowest keys, here over every snapshot
+    std::vector<size_t> pos(m_snaps.size(), 0);
+    while (entries.size() < kMaxListEntries) {
+        size_t from = m_snaps.size();
+        for (size_t i = 0; i < m_snaps.size(); ++i) {
+            if (pos[i] == m_snaps[i]->entries.size()) continue;
+            if (from == m_snaps.size() || m_snaps[i]->entries[pos[i]].sessionKey < m_snaps[from]->entries[pos[from]].sessionKey) from = i;
+        }
+        if (from == m_snaps.size()) break;
+
+        const lobby::SessionEntry& e = m_snaps[from]->entries[pos[from]++];
+        entries.push_back(e);
+        if (e.addrFamily != lobby::AddrIPv6) continue;
+        if (const auto* a = findAddr6(m_snaps[from]->addrs6, e.sessionKey)) addrs.push_back(*a);
+    }
+}
+
+void LobbyShard::sendPageFromSnapshots(HSteamNetConnection to, const lobby::ListReq& req, SteamNetworkingMicroseconds recvUsec) {
+    loadSnapshots();
+
+    const size_t want = std::min<size_t>(req.pageSize, lobby::kMaxPageEntries);
+    const size_t prefixLen = strnlen(req.namePrefix, sizeof(req.namePrefix));
+
+    std::vector<uint8_t> buf(sizeof(lobby::ListRespHdr) + want * sizeof(lobby::SessionEntry));
+    uint8_t* out = buf.data() + sizeof(lobby::ListRespHdr);
+
+    // Merge the key-ordered snapshots from just after the cursor (same bounded scan as sendPage)
+    using EntryIter = std::vector<lobby::SessionEntry>::const_iterator;
+    std::vector<std::pair<EntryIter, EntryIter>> sources;
+    std::vector<const Snapshot*> sourceSnaps;
+    for (const auto& s : m_snaps) {
+        auto it = std::upper_bound(s->entries.begin(), s->entries.end(), req.cursor,
+            [](uint64_t key, const lobby::SessionEntry& e) { return key < e.sessionKey; });
+        if (it == s->entries.end()) continue;
+        sources.emplace_back(it, s->entries.end());
+        sourceSnaps.push_back(s);
+    }
+
+    std::vector<lobby::SessionAddr6> addrs;
+    uint16_t count = 0;
+    size_t scanned = 0;
+    uint64_t lastKey = req.cursor;
+    uint64_t nextCursor = 0;
+    for (;;) {
+        std::pair<EntryIter, EntryIter>* src = nullptr;
+        for (auto& r : sources) {
+            if (r.first != r.second && (!src || r.first->sessionKey < src->first->sessionKey)) src = &r;
+        }
+        if (!src) break;
+
+        if (count == want || scanned == kMaxPageScan) {
+            nextCursor = lastKey;
+            break;
+        }
+        ++scanned;
+
+        const Snapshot& snap = *sourceSnaps[src - sources.data()];
+        const lobby::SessionEntry& e = *src->first++;
+        lastKey = e.sessionKey;
+        if (!pageFilterMatches(e, snap.reserved[&e - snap.entries.data()], req, prefixLen)) continue;
+
+        std::memcpy(out, &e, sizeof(e));
+        out += sizeof(e);
+        ++count;
+        if (e.addrFamily == lobby::AddrIPv6) {
+            if (const auto* a = findAddr6(snap.addrs6, e.sessionKey)) addrs.push_back(*a);
+        }
+    }
+
+    lobby::ListRespHdr hdr{};
+    hdr.type = lobby::Type::ListResp;
+    hdr.kind = lobby::ListKind::Page;
+    hdr.listEpoch = combinedEpoch();
+    hdr.listVersion = m_snapsVersion;
+    hdr.count = count;
+    hdr.nextCursor = nextCursor;
+    std::memcpy(buf.data(), &hdr, sizeof(hdr));
+    buf.resize(sizeof(hdr) + (size_t)count * sizeof(lobby::SessionEntry));
+    appendAddrs6(buf, addrs);
+
+    queueBytes(to, std::move(buf), recvUsec);
+}
+
+LobbyShard* LobbyShard::quickMatchShard() {
+    // Our own live state wins ties, so most requests are answered without a hop
+    LobbyShard* best = this;
+    uint8_t bestFree = 0;
+    for (size_t b = 1; b < m_openByFree.size(); ++b) {
+        if (!m_openByFree[b].empty()) { bestFree = (uint8_t)b; break; }
+    }
+
+    for (uint32_t i = 0; i < m_server.shardCount(); ++i) {
+        if (i == m_index) continue;
+        const uint8_t f = m_server.shard(i).snapshot()->bestFree;
+        if (f && (bestFree == 0 || f < bestFree)) {
+            best = &m_server.shard(i);
+            bestFree = f;
+        }
+    }
+    return best;
+}
+
+void LobbyShard::drainListLatency(LatencyHistogram& out) {
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    out.merge(m_listLatency);
+    m_listLatency.reset();
+}
+
+void LobbyShard::drainStats(LobbyStats& out) {
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    out.merge(m_stats);
+    m_stats.resetWindow();
+}
+
+bool LobbyShard::restoreSession(const lobby_snapshot::Record& r, int64_t nowMs, int64_t fileAgeMs) {
+    using namespace std::chrono;
+
+    if (r.sessionKey == 0 || m_sessions.contains(r.sessionKey)) return false;
+    if (r.addrFamily != lobby::AddrIPv4 && r.addrFamily != lobby::AddrIPv6) return false;
+
+    // Had the lobby stayed up, everything in a file this old would have expired by now
+    if (fileAgeMs > duration_cast<milliseconds>(kActiveTTL + kGraceTTL).count()) return false;
+
+    // Grace is wall-clock time, so the restart itself counts against it
+    const bool migrating = (r.state == lobby::SessionState::Migrating);
+    const auto graceUsed = milliseconds(std::max<int64_t>(0, nowMs - r.migratingSinceMs));
+    if (migrating && graceUsed >= kGraceTTL) return false;
+
+    const auto now = Clock::now();
+    const uint8_t maxPlayers = r.maxPlayers ? r.maxPlayers : 3;
+
+    Session& s = m_sessions.insert(r.sessionKey);
+    s.maxPlayers = maxPlayers;
+    s.curPlayers = std::clamp<uint8_t>(r.curPlayers, 1, maxPlayers);
+
+    SessionInfo& info = m_sessions.info(s);
+    info.ipv4_host_order = r.ipv4_host_order;
+    info.addrFamily = r.addrFamily;
+    std::memcpy(info.ipv6, r.ipv6, sizeof(info.ipv6));
+    info.gamePort = r.gamePort;
+    info.worldSeed = r.worldSeed;
+    std::memcpy(info.name, r.name, sizeof(info.name));
+
+    if (migrating) {
+        s.state = lobby::SessionState::Migrating;
+        s.migratingSince = now - graceUsed;
+    }
+    else {
+        // Provisional: listed as before but with no owner conn, so heartbeats are ignored until the
+        // host re-announces. Its TTL starts now; a host can't heartbeat while the lobby is down.
+        s.state = (s.curPlayers >= s.maxPlayers) ? lobby::SessionState::Full : lobby::SessionState::Open;
+        s.lastSeen = now;
+        scheduleExpiry(s);
+    }
+
+    listUpsert(s);
+    return true;
+}
+
+void LobbyShard::exportSessions() {
+    using namespace std::chrono;
+
+    const auto now = Clock::now();
+    m_nextExport = now + kExportInterval;
+    if (m_exportedVersion == m_listVersion && now - m_exportedAt < kExportRefresh) return;
+    m_exportedVersion = m_listVersion;
+    m_exportedAt = now;
+
+    const int64_t nowMs = lobby_snapshot::unixNowMs();
+
+    std::vector<lobby_snapshot::Record> records;
+    records.reserve(m_sessions.size());
+    for (const Session& s : m_sessions) {
+        if (s.origin != 0) continue; // a peer's; it comes back over the link
+        const SessionInfo& info = m_sessions.info(s);
+
+        lobby_snapshot::Record r{};
+        r.sessionKey = s.sessionKey;
+        r.ipv4_host_order = info.ipv4_host_order;
+        r.addrFamily = info.addrFamily;
+        std::memcpy(r.ipv6, info.ipv6, sizeof(r.ipv6));
+        r.gamePort = info.gamePort;
+        r.curPlayers = s.curPlayers;
+        r.maxPlayers = s.maxPlayers;
+        r.worldSeed = info.worldSeed;
+        r.state = s.state;
+        if (s.state == lobby::SessionState::Migrating) {
+            r.migratingSinceMs = nowMs - duration_cast<milliseconds>(now - s.migratingSince).count();
+        }
+        std::memcpy(r.name, info.name, sizeof(r.name));
+        records.push_back(r);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_exportMutex);
+        m_export.swap(records);
+    }
+    m_exportDirty.store(true, std::memory_order_release);
+}
+
+void LobbyShard::appendExport(std::vector<lobby_snapshot::Record>& out) {
+    std::lock_guard<std::mutex> lock(m_exportMutex);
+    m_exportDirty.store(false, std::memory_order_relaxed);
+    out.insert(out.end(), m_export.begin(), m_export.end());
+}
+
+void LobbyShard::flushOutbox() {
+    if (m_outbox.empty()) return;
+
+    // SendMessages takes ownership of the messages; note the list response sizes first
+    {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        for (const auto* msg : m_outbox) {
+            if (*(const lobby::Type*)msg->m_pData == lobby::Type::ListResp) m_stats.listBytes.record(msg->m_cbSize);
+        }
+    }
+
+    m_iface->SendMessages((int)m_outbox.size(), m_outbox.data(), nullptr);
+
+    const auto sentUsec = SteamNetworkingUtils()->GetLocalTimestamp();
+    {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        for (auto recvUsec : m_outboxRecvUsec) {
+            if (!recvUsec) continue;
+            m_listLatency.record(sentUsec - recvUsec);
+            m_stats.listLatency.record(sentUsec - recvUsec);
+        }
+    }
+
+    m_outbox.clear();
+    m_outboxRecvUsec.clear();
+}
+
+void LobbyShard::foldStats(Clock::duration pumpTime, int handled) {
+    using namespace std::chrono;
+
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    for (size_t i = 0; i < m_pumpMessages.size(); ++i) m_stats.messages[i] += m_pumpMessages[i];
+    for (size_t i = 0; i < m_pumpDropped.size(); ++i) m_stats.dropped[i] += m_pumpDropped[i];
+    if (handled > 0) m_stats.pumpUsec.record(duration_cast<microseconds>(pumpTime).count());
+    if (m_pumpCleanupRan) m_stats.cleanupUsec.record(duration_cast<microseconds>(m_pumpCleanup).count());
+    m_stats.sessions = m_stateCounts;
+    m_stats.subscribers = (uint32_t)m_subscribers.size();
+
+    m_pumpMessages.fill(0);
+    m_pumpDropped.fill(0);
+    m_pumpCleanup = Clock::duration{};
+    m_pumpCleanupRan = false;
+}
+
+int LobbyShard::pump() {
+    if (!m_iface || m_poll == k_HSteamNetPollGroup_Invalid) return 0;
+
+    const auto pumpStart = Clock::now();
+    cleanupExpired();
+
+    int handled = drainInbox();
+
+    SteamNetworkingMessage_t* msgs[32];
+    for (;;) {
+        const int n = m_iface->ReceiveMessagesOnPollGroup(m_poll, msgs, 32);
+        if (n <= 0) break;
+
+        for (int i = 0; i < n; ++i) {
+            if (msgs[i]->m_cbSize > 0) {
+                const uint8_t type = *(const uint8_t*)msgs[i]->m_pData;
+                ++m_pumpMessages[LobbyStats::messageSlot(type)];
+                if (admit(msgs[i]->m_conn, type, msgs[i]->m_usecTimeReceived))
+                    handleMessage(msgs[i]->m_conn, msgs[i]->m_pData, (uint32_t)msgs[i]->m_cbSize, msgs[i]->m_usecTimeReceived);
+                else
+                    ++m_pumpDropped[LobbyStats::messageSlot(type)];
+            }
+            msgs[i]->Release();
+        }
+        handled += n;
+    }
+
+    // List reads earlier in this pump saw curPlayers as of the previous batch; pushes below see these
+    applyHeartbeats();
+
+    if (sharded()) {
+        publishSnapshot();
+        m_snapshot.reclaim(m_server.rcu());
+    }
+    pushToSubscribers();
+    flushOutbox();
+    exportPeerChanges();
+
+    m_snaps.clear(); // other shards may free these once we go quiescent
+
+    if (m_server.persisting() && Clock::now() >= m_nextExport) exportSessions();
+
+    foldStats(Clock::now() - pumpStart, handled);
+    return handled;
+}
\ No newline at end of file
@@ -0,0 +1,343 @@
+#pragma once
+#include <unordered_map>
+#include <vector>
+#include <array>
+#include <deque>
+#include <set>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+#include <chrono>
+
+#include <steam/steamnetworkingsockets.h>
+#include <steam/isteamnetworkingsockets.h>
+#include <steam/steamnetworkingtypes.h>
+#include <steam/isteamnetworkingutils.h>
+
+#include "LobbyProtocol.hpp"
+#include "LatencyHistogram.hpp"
+#include "LobbyStats.hpp"
+#include "SharedPayload.hpp"
+#include "LobbySnapshot.hpp"
+#include "SessionTable.hpp"
+#include "FlatMap.hpp"
+#include "Rcu.hpp"
+
+class LobbyServer;
+
+// One worker's slice of the lobby: the sessions whose key hashes to this shard, plus the
+// connections the server assigned to this shard's poll group. Everything here belongs to the
+// thread that pumps the shard, except the inbox and the published snapshot (RCU, lock-free reads).
+class LobbyShard {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Immutable copy of this shard's list, republished after any pump that changed it.
+    // Other shards build Full lists, pages and QuickMatch picks from these.
+    struct Snapshot {
+        uint32_t version{ 0 };                     // this shard's m_listVersion
+        std::vector<lobby::SessionEntry> entries;  // sessionKey order
+        std::vector<lobby::SessionAddr6> addrs6;   // the AddrIPv6 entries' addresses, sessionKey order
+        std::vector<uint8_t> reserved;             // per entry: QuickMatch slot holds (not on the wire)
+        uint8_t bestFree{ 0 };                     // lowest non-empty free-slot bucket (0 = nothing open)
+    };
+
+    LobbyShard(LobbyServer& server, uint32_t index);
+    ~LobbyShard();
+
+    bool start(ISteamNetworkingSockets* iface);
+    void stop();
+
+    int pump(); // returns number of messages handled (own poll group + inbox)
+    Clock::time_point nextDeadline() const;
+
+    // Any thread: hand this shard a message for one of its sessions, or tell it a conn closed
+    void post(HSteamNetConnection from, const void* data, uint32_t size, SteamNetworkingMicroseconds recvUsec);
+    void postConnClosed(HSteamNetConnection conn);
+
+    // Worker thread: sleep until posted to / woken, or `until`
+    void waitForWork(Clock::time_point until);
+    void wake();
+
+    // Any worker: valid until that worker's next RCU quiescent state (i.e. for the current pump)
+    const Snapshot* snapshot() const { return m_snapshot.load(); }
+    void drainListLatency(LatencyHistogram& out);
+    void drainStats(LobbyStats& out); // any thread: merge this shard's window into `out`, start the next
+
+    // Session snapshot file. restoreSession runs before any worker starts; the owner has to
+    // re-announce within kActiveTTL or the session goes Migrating as if its host had dropped.
+    bool restoreSession(const lobby_snapshot::Record& r, int64_t nowMs, int64_t fileAgeMs);
+    void exportSessions(); // pump thread (or stopped): copy the table out for the server to write
+    bool exportDirty() const { return m_exportDirty.load(std::memory_order_acquire); }
+    void appendExport(std::vector<lobby_snapshot::Record>& out); // any thread; clears exportDirty
+
+    HSteamNetPollGroup pollGroup() const { return m_poll; }
+    uint32_t index() const { return m_index; }
+
+    // Federation (LobbyPeers). A peer's session as it arrived, or one of ours as it left.
+    struct PeerUpdate {
+        enum Op : uint8_t { Upsert, Players, Remove, DropOrigin } op;
+        uint8_t origin;            // link index + 1
+        lobby::SessionEntry entry; // Players: only sessionKey, curPlayers, state; DropOrigin: unused
+        uint8_t ipv6[16];          // AddrIPv6 entries only
+    };
+    struct PeerRecord {
+        lobby::SessionEntry entry;
+        uint8_t ipv6[16];
+        bool removed;              // entry.sessionKey only
+    };
+    void postPeer(const std::vector<PeerUpdate>& updates); // any thread, applied at the next pump
+    void takePeerChanges(std::vector<PeerRecord>& out);    // any thread: our sessions changed since last time
+
+private:
+    using Session = LobbySession;         // hot fields, see SessionTable.hpp
+    using SessionInfo = LobbySessionInfo; // cold fields
+    static constexpr uint32_t kNoListSlot = LobbySession::kNoListSlot;
+
+    // Min-heap entry for the active-session TTL (grace expiry goes by m_migratingBySince).
+    // Heartbeats only push lastSeen forward, so instead of re-queueing on every heartbeat an
+    // entry is re-armed lazily when it pops early; entries whose `at` no longer matches the
+    // session's expiryAt are stale and dropped.
+    struct Expiry {
+        Clock::time_point at;
+        uint64_t sessionKey;
+        bool operator>(const Expiry& o) const { return at > o.at; }
+    };
+
+    // Token bucket per connection and message class (see kBudgetRules)
+    enum BudgetClass : uint8_t { kBudgetList, kBudgetAnnounce, kBudgetHeartbeat, kBudgetQuickMatch, kBudgetOther, kBudgetClasses };
+    struct BudgetRule {
+        uint16_t perSecond;
+        uint16_t burst;
+    };
+    struct ConnBudget {
+        uint32_t refilledMs;                              // recvUsec / 1000 of the last refill
+        std::array<uint16_t, kBudgetClasses> milliTokens; // per class, capped at burst * 1000
+    };
+
+    // Messages for a session owned by another shard are posted there; fromInbox = already routed
+    void handleMessage(HSteamNetConnection from, const void* data, uint32_t size, SteamNetworkingMicroseconds recvUsec, bool fromInbox = false);
+    int drainInbox();
+    void connClosed(HSteamNetConnection conn);
+    void applyHeartbeats(); // this pump's batch: one clock read, one update per session
+
+    uint32_t sendList(HSteamNetConnection to, uint32_t haveEpoch, uint32_t haveVersion, SteamNetworkingMicroseconds recvUsec); // returns version sent
+    void sendPage(HSteamNetConnection to, const lobby::ListReq& req, SteamNetworkingMicroseconds recvUsec);
+    void sendQuickMatch(HSteamNetConnection to, bool reserve);
+    void queueBytes(HSteamNetConnection to, std::vector<uint8_t>&& bytes, SteamNetworkingMicroseconds recvUsec);
+    void pushToSubscribers(); // once per pump: everything that changed, as one Delta per subscriber
+    void flushOutbox();
+    void foldStats(Clock::duration pumpTime, int handled); // once per pump: scratch counters -> m_stats
+
+    // Several shards: lists are assembled from every shard's snapshot. The list version a client
+    // holds is then the sum of the shard versions as this shard read them. Each new one is diffed
+    // against the list served before and logged, so Deltas work as with one shard. Sums only order
+    // this shard's reads, so its clients get an epoch of their own.
+    bool sharded() const;
+    uint32_t combinedEpoch() const;
+    uint32_t loadSnapshots(); // fills m_snaps/m_snapsVersion, returns the combined version
+    void publishSnapshot();
+    SharedPayload* combinedListResponse(uint32_t haveEpoch, uint32_t haveVersion); // from m_snaps
+    void mergeSnapshots(std::vector<lobby::SessionEntry>& entries, std::vector<lobby::SessionAddr6>& addrs) const; // the list window over m_snaps
+    void advanceCombined(); // m_snaps -> m_combinedEntries, logging what changed
+    std::vector<uint8_t> buildCombinedList(uint32_t baseVersion); // 0 = Full
+    void sendPageFromSnapshots(HSteamNetConnection to, const lobby::ListReq& req, SteamNetworkingMicroseconds recvUsec);
+    LobbyShard* quickMatchShard(); // shard whose snapshot has the best QuickMatch candidate
+
+    // Keep m_listEntries and the secondary indexes in step with m_sessions; call after any change
+    // visible in a SessionEntry. Each real change bumps m_listVersion and is logged for deltas.
+    void listUpsert(Session& s, bool addrChanged = false); // addrChanged: IPv6 address (not in the entry)
+    void listRemove(Session& s);
+    void listChanged(uint64_t sessionKey);
+    void listOrderInsert(uint64_t sessionKey);
+    void listOrderErase(uint64_t sessionKey);
+    bool inListWindow(uint64_t sessionKey) const;
+    void indexUpdate(Session& s);
+    void indexRemove(Session& s);
+
+    // Full/Delta/Unchanged response for a client holding (epoch, version); cached per version
+    SharedPayload* listResponse(uint32_t haveEpoch, uint32_t haveVersion);
+    std::vector<uint8_t> buildFullList() const;
+    std::vector<uint8_t> buildListDelta(uint32_t baseVersion);
+    lobby::ListRespHdr listHeader(lobby::ListKind kind, uint32_t baseVersion) const;
+
+    void cleanupExpired(); // TTL + grace cleanup, only touches sessions whose deadline passed
+    void markMigrating(uint64_t sessionKey);
+
+    void applyPeerUpdate(const PeerUpdate& u);
+    void exportPeerChanges(); // once per pump: m_peerDirty -> m_peerOut
+
+    void scheduleExpiry(Session& s); // queue s if its TTL deadline is earlier than what's queued
+
+    bool fillRemoteAddr(HSteamNetConnection from, SteamNetworkingIPAddr& out);
+    lobby::SessionAddr6 addr6(const Session& s) const;
+
+    // Charges one token from `from`'s bucket for this message type; false = over budget, drop it
+    bool admit(HSteamNetConnection from, uint8_t type, SteamNetworkingMicroseconds recvUsec);
+    static BudgetClass budgetClass(uint8_t type);
+
+private:
+    LobbyServer& m_server;
+    uint32_t m_index;
+
+    ISteamNetworkingSockets* m_iface{ nullptr };
+    HSteamNetPollGroup m_poll{ k_HSteamNetPollGroup_Invalid };
+
+    // Posted by other shards' threads and the connection callback; swapped out once per pump
+    struct Posted {
+        HSteamNetConnection from;
+        SteamNetworkingMicroseconds recvUsec;
+        uint8_t size;                           // 0 = `from` closed
+        uint8_t data[sizeof(lobby::Announce)];  // largest message that gets routed
+    };
+    std::mutex m_inboxMutex;
+    std::vector<Posted> m_inbox;
+    std::vector<Posted> m_inboxDrain;
+    std::vector<PeerUpdate> m_peerInbox; // also guarded by m_inboxMutex
+    std::vector<PeerUpdate> m_peerDrain;
+
+    // Heartbeats are only queued while a pump drains messages, then applied together: sorted by
+    // key (arrival order within a key), so each session is looked up and recomputed once
+    struct PendingHeartbeat {
+        uint64_t sessionKey;
+        uint32_t seq;
+        HSteamNetConnection from;
+        uint16_t curPlayers;
+        bool operator<(const PendingHeartbeat& o) const { return sessionKey != o.sessionKey ? sessionKey < o.sessionKey : seq < o.seq; }
+    };
+    std::vector<PendingHeartbeat> m_heartbeats;
+
+    std::condition_variable m_wakeCv;
+    bool m_woken{ false }; // guarded by m_inboxMutex
+
+    RcuPtr<Snapshot> m_snapshot;
+    uint32_t m_publishedVersion{ 0 };
+    uint8_t m_publishedBestFree{ 0 };
+    uint32_t m_publishedReserveGen{ 0 };
+    std::vector<const Snapshot*> m_snaps; // every shard's, as of loadSnapshots; cleared after each pump
+    uint32_t m_snapsVersion{ 0 };
+
+    // host lobby connection -> sessionKey (only for current owner conns)
+    FlatMap<HSteamNetConnection, uint64_t> m_connToSession;
+
+    // sessionKey -> session record (flat; references don't survive an insert or erase)
+    SessionTable m_sessions;
+
+    // Request budgets of the conns in this shard's poll group. Charged when a message comes off the
+    // poll group, before it's routed or answered; messages from the inbox were charged already.
+    FlatMap<HSteamNetConnection, ConnBudget> m_budgets;
+
+    // browser conns that asked for pushed list updates -> list version they were last sent
+    std::unordered_map<HSteamNetConnection, uint32_t> m_subscribers;
+    uint32_t m_pushedVersion{ 0 };
+
+    std::vector<Expiry> m_expiry; // min-heap on `at`, active sessions only
+
+    // QuickMatch slot holds in expiry order (all share kReserveTTL, so a FIFO is enough)
+    struct Reservation {
+        Clock::time_point until;
+        uint64_t sessionKey;
+    };
+    std::deque<Reservation> m_reservations;
+    uint32_t m_reserveGen{ 0 }; // bumped whenever a session's reservedSlots changes
+
+    // Secondary indexes, maintained by listUpsert/listRemove:
+    // Open sessions by unreserved free-slot count (bucket 0 unused), keys in order for paging
+    std::vector<std::set<uint64_t>> m_openByFree;
+    // Migrating sessions, oldest first; the front is the next grace expiry
+    std::set<std::pair<Clock::time_point, uint64_t>> m_migratingBySince;
+
+    // Wire-format list entries, patched in place as sessions change (dense, unordered)
+    std::vector<lobby::SessionEntry> m_listEntries;
+    uint32_t m_listAddr6{ 0 }; // how many of them are AddrIPv6 (Full lists skip the address scan at 0)
+
+    // Listed sessionKeys in key order; paged ListReq walks this from the client's cursor
+    std::set<uint64_t> m_listOrder;
+    // Past kMaxListEntries, Full and Delta cover only the lowest keys; this is the last of them
+    std::set<uint64_t>::iterator m_windowLast;
+
+    // List versioning: every visible change bumps the version and logs the key it touched (keys
+    // outside the window only bump it). The log holds every change newer than m_listLogFloor, so a
+    // client at >= floor can get a delta.
+    struct ListChange {
+        uint32_t version;
+        uint64_t sessionKey;
+    };
+    uint32_t m_listVersion{ 1 };
+    uint32_t m_listLogFloor{ 1 };
+    std::deque<ListChange> m_listLog;
+    std::vector<uint64_t> m_deltaKeys; // scratch
+
+    // Serialized responses for the current m_listVersion, keyed by the version the client holds
+    // (0 = Full). Shared by every requester at that version until the list changes again.
+    struct CachedResp {
+        uint32_t haveVersion;
+        SharedPayload* payload;
+    };
+    std::vector<CachedResp> m_respCache;
+    uint32_t m_respCacheVersion{ 0 };
+
+    // Sharded: the combined list as last served (m_combinedVersion), its change log (as m_listLog,
+    // but one version can log many keys) and the responses cached for that version
+    uint32_t m_combinedVersion{ 0 }; // 0 = none served yet
+    std::vector<lobby::SessionEntry> m_combinedEntries; // sessionKey order
+    std::vector<lobby::SessionAddr6> m_combinedAddrs6;  // sessionKey order
+    std::deque<ListChange> m_combinedLog;
+    uint32_t m_combinedLogFloor{ 0 };
+    std::vector<CachedResp> m_combinedCache;
+
+    // Responses queued during a pump, sent in one SendMessages() call at the end
+    std::vector<SteamNetworkingMessage_t*> m_outbox;
+    std::vector<SteamNetworkingMicroseconds> m_outboxRecvUsec; // ListReq arrival, for latency
+
+    std::mutex m_statsMutex; // m_listLatency and m_stats are drained from the stats thread
+    LatencyHistogram m_listLatency;
+    LobbyStats m_stats;
+
+    // Pump-thread scratch, folded into m_stats under one lock at the end of each pump
+    std::array<uint32_t, lobby::kStatsMsgTypes> m_pumpMessages{};
+    std::array<uint32_t, lobby::kStatsMsgTypes> m_pumpDropped{};
+    Clock::duration m_pumpCleanup{};
+    bool m_pumpCleanupRan{ false };
+    std::array<uint32_t, 4> m_stateCounts{}; // listed sessions by lobby::SessionState value
+
+    // Latest copy of the table for the session snapshot file, taken every kExportInterval when
+    // the list changed (and every kExportRefresh regardless, so the file never looks stale)
+    std::mutex m_exportMutex;
+    std::vector<lobby_snapshot::Record> m_export;
+    std::atomic<bool> m_exportDirty{ false };
+    Clock::time_point m_nextExport{};
+    Clock::time_point m_exportedAt{};
+    uint32_t m_exportedVersion{ 0 };
+
+    // Federated only: keys of local sessions whose list entry changed this pump, resolved at the
+    // end of the pump into records for LobbyPeers (taken from the server thread)
+    std::vector<uint64_t> m_peerDirty;
+    std::mutex m_peerMutex;
+    std::vector<PeerRecord> m_peerOut;
+
+private:
+    // Tunables (keep lobby dumb but resilient)
+    static constexpr std::chrono::seconds kActiveTTL{ 12 };    // if no heartbeat, consider host gone
+    static constexpr std::chrono::seconds kGraceTTL{ 25 };     // time allowed for Claim after host loss
+    static constexpr std::chrono::seconds kReserveTTL{ 5 };    // QuickMatch slot hold, long enough to connect
+    static constexpr std::chrono::seconds kExportInterval{ 5 }; // session snapshot: at most this stale
+    static constexpr std::chrono::seconds kExportRefresh{ 10 }; // session snapshot: rewrite even if unchanged
+    static constexpr size_t kListLogCap = 4096;                // changes kept for delta responses
+    static constexpr size_t kRespCacheCap = 32;                // distinct client versions cached per list version
+    static constexpr size_t kMaxListEntries = 512;             // Full/Delta window: the lowest keys (page for the rest)
+    static constexpr size_t kMaxPageScan = 256;                // entries examined per paged ListReq
+
+    // Request budgets per connection (BudgetClass order). Generous next to what LobbyClient sends
+    // (a heartbeat a second, a list poll every few seconds, a burst of pages while browsing) so
+    // only a misbehaving client ever runs dry.
+    static constexpr BudgetRule kBudgetRules[kBudgetClasses] = {
+        { 20, 40 }, // ListReq (full or paged), Subscribe, Unsubscribe
+        { 2, 6 },   // Announce, Claim
+        { 4, 8 },   // Heartbeat
+        { 2, 5 },   // QuickMatch
+        { 2, 5 },   // Hello, StatsReq, unknown types
+    };
+};
\ No newline at end of file
@@ -0,0 +1,93 @@
+#include "LobbySnapshot.hpp"
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cstddef>
+#include <chrono>
+#include <filesystem>
+#include <system_error>
+
+namespace lobby_snapshot {
+
+// Version 1 records are Record up to and including name (IPv4 hosts only)
+static constexpr size_t kRecordV1Size = offsetof(Record, ipv6);
+
+int64_t unixNowMs() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+bool write(const std::string& path, const std::vector<Record>& records) {
+    FileHeader hdr{};
+    hdr.magic = kMagic;
+    hdr.version = kVersion;
+    hdr.count = (uint32_t)records.size();
+    hdr.writtenAtMs = unixNowMs();
+
+    // Readers only ever see a complete file: write beside it, then swap it in
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        if (!f) {
+            std::cerr << "[Lobby] Can't write session snapshot " << tmp << "\n";
+            return false;
+        }
+        f.write((const char*)&hdr, sizeof(hdr));
+        if (!records.empty()) f.write((const char*)records.data(), (std::streamsize)(records.size() * sizeof(Record)));
+        if (!f) {
+            std::cerr << "[Lobby] Session snapshot write failed: " << tmp << "\n";
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp, path, ec); // replaces the old file
+    if (ec) {
+        std::cerr << "[Lobby] Session snapshot rename failed: " << ec.message() << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool read(const std::string& path, std::vector<Record>& out, int64_t& writtenAtMs) {
+    out.clear();
+
+    std::ifstream f(path, std::ios::binary | std::ios::ate);
+    if (!f) return false;
+
+    // One read of the whole file; records are copied out of the buffer as-is
+    const std::streamoff size = f.tellg();
+    if (size < (std::streamoff)sizeof(FileHeader)) return false;
+
+    std::vector<char> buf((size_t)size);
+    f.seekg(0);
+    if (!f.read(buf.data(), size)) return false;
+
+    FileHeader hdr{};
+    std::memcpy(&hdr, buf.data(), sizeof(hdr));
+    if (hdr.magic != kMagic || (hdr.version != kVersion && hdr.version != 1)) {
+        std::cerr << "[Lobby] Ignoring session snapshot " << path << " (unknown format)\n";
+        return false;
+    }
+    const size_t recordSize = (hdr.version == 1) ? kRecordV1Size : sizeof(Record);
+    if ((size_t)size != sizeof(hdr) + (size_t)hdr.count * recordSize) {
+        std::cerr << "[Lobby] Ignoring session snapshot " << path << " (truncated)\n";
+        return false;
+    }
+
+    out.resize(hdr.count);
+    if (recordSize == sizeof(Record)) {
+        if (hdr.count) std::memcpy(out.data(), buf.data() + sizeof(hdr), (size_t)hdr.count * sizeof(Record));
+    }
+    else {
+        // Older records are a prefix of the current one; the rest stays zero (AddrIPv4)
+        for (uint32_t i = 0; i < hdr.count; ++i) {
+            out[i] = Record{};
+            std::memcpy(&out[i], buf.data() + sizeof(hdr) + (size_t)i * recordSize, recordSize);
+        }
+    }
+    writtenAtMs = hdr.writtenAtMs;
+    return true;
+}
+
+} // namespace lobby_snapshot
\ No newline at end of file
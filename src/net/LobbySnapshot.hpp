@@ -0,0 +1,50 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "LobbyProtocol.hpp"
+
+// On-disk copy of the lobby's session table, so a restarted lobby lists every session again
+// straight away instead of waiting for each host to re-announce. Times are wall-clock (unix ms)
+// so they survive the restart; the file is rewritten whole (temp file + rename) each time.
+namespace lobby_snapshot {
+
+    static constexpr uint32_t kMagic = 0x534F4C52; // "RLOS"
+    static constexpr uint32_t kVersion = 2; // 2: IPv6 hosts (version 1 files are still read)
+
+#pragma pack(push, 1)
+
+    struct FileHeader {
+        uint32_t magic;        // kMagic
+        uint32_t version;      // kVersion
+        uint32_t count;        // Record entries that follow
+        uint32_t reserved0;
+        int64_t  writtenAtMs;  // unix ms
+    };
+
+    struct Record {
+        uint64_t sessionKey;
+        uint32_t ipv4_host_order;
+        uint16_t gamePort;
+        uint8_t  curPlayers;
+        uint8_t  maxPlayers;
+        uint32_t worldSeed;
+        lobby::SessionState state;
+        uint8_t  addrFamily;        // lobby::AddrFamily
+        uint8_t  reserved0[2];
+        int64_t  migratingSinceMs;  // unix ms, Migrating only
+        char     name[32];
+        uint8_t  ipv6[16];          // AddrIPv6 only
+    };
+
+#pragma pack(pop)
+
+    int64_t unixNowMs();
+
+    bool write(const std::string& path, const std::vector<Record>& records);
+
+    // false if the file is missing or unusable; writtenAtMs = when it was written (unix ms)
+    bool read(const std::string& path, std::vector<Record>& out, int64_t& writtenAtMs);
+
+} // namespace lobby_snapshot
\ No newline at end of file
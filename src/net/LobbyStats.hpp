@@ -0,0 +1,43 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+#include "LobbyProtocol.hpp"
+#include "LatencyHistogram.hpp"
+
+// One stats window of lobby health counters. Each shard keeps its own, filled on its pump thread;
+// the server merges every shard's into a report and starts the next window.
+struct LobbyStats {
+    std::array<uint64_t, lobby::kStatsMsgTypes> messages{}; // received, by lobby::Type value
+    std::array<uint64_t, lobby::kStatsMsgTypes> dropped{};  // over the sender's request budget
+    LatencyHistogram listLatency;  // usec
+    LatencyHistogram listBytes;    // one sample per ListResp sent
+    LatencyHistogram pumpUsec;
+    LatencyHistogram cleanupUsec;
+
+    // Gauges: current value, summed across shards, not cleared with the window
+    std::array<uint32_t, 4> sessions{}; // by lobby::SessionState value
+    uint32_t subscribers{ 0 };
+
+    static size_t messageSlot(uint8_t type) { return (type < lobby::kStatsMsgTypes) ? type : 0; }
+
+    void merge(const LobbyStats& o) {
+        for (size_t i = 0; i < messages.size(); ++i) messages[i] += o.messages[i];
+        for (size_t i = 0; i < dropped.size(); ++i) dropped[i] += o.dropped[i];
+        listLatency.merge(o.listLatency);
+        listBytes.merge(o.listBytes);
+        pumpUsec.merge(o.pumpUsec);
+        cleanupUsec.merge(o.cleanupUsec);
+        for (size_t i = 0; i < sessions.size(); ++i) sessions[i] += o.sessions[i];
+        subscribers += o.subscribers;
+    }
+
+    void resetWindow() {
+        messages.fill(0);
+        dropped.fill(0);
+        listLatency.reset();
+        listBytes.reset();
+        pumpUsec.reset();
+        cleanupUsec.reset();
+    }
+};
\ No newline at end of file
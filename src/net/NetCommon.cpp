@@ -1,5 +1,7 @@
 #include "NetCommon.hpp"
 #include <iostream>
+#include <thread>
+#include <chrono>
 
 static NetRuntime* g_rt = nullptr;
 
@@ -15,6 +17,10 @@ void NetRuntime::s_onConnStatusChanged(SteamNetConnectionStatusChangedCallback_t
 bool NetRuntime::init(const NetRuntimeConfig& cfg) {
     g_rt = this;
 
+    // Must be selected before init so no service thread gets spawned
+    m_manualPoll = cfg.manualPoll;
+    SteamNetworkingSockets_SetManualPollMode(m_manualPoll);
+
     SteamDatagramErrMsg errMsg{};
     if (!GameNetworkingSockets_Init(nullptr, errMsg)) {
         std::cerr << "GameNetworkingSockets_Init failed: " << errMsg << "\n";
@@ -41,4 +47,13 @@ void NetRuntime::shutdown() {
 
 void NetRuntime::pumpCallbacks() {
     if (m_iface) m_iface->RunCallbacks();
+}
+
+void NetRuntime::pollSockets(int maxWaitMs) {
+    if (maxWaitMs < 0) maxWaitMs = 0;
+    if (m_iface && m_manualPoll) {
+        SteamNetworkingSockets_Poll(maxWaitMs);
+        return;
+    }
+    if (maxWaitMs > 0) std::this_thread::sleep_for(std::chrono::milliseconds(maxWaitMs));
 }
\ No newline at end of file
@@ -9,6 +9,10 @@
 
 struct NetRuntimeConfig {
     ESteamNetworkingSocketsDebugOutputType debugLevel = k_ESteamNetworkingSocketsDebugOutputType_Msg;
+
+    // No GNS service thread; the app drives socket IO via pollSockets(). Lets a
+    // dedicated server block on its sockets instead of sleeping a fixed interval.
+    bool manualPoll = false;
 };
 
 class NetRuntime {
@@ -23,6 +27,10 @@ public:
     // Call once per frame/tick. Required so connection state callbacks get delivered.
     void pumpCallbacks();
 
+    // Blocks up to maxWaitMs for socket activity (manual poll mode), otherwise just sleeps.
+    void pollSockets(int maxWaitMs);
+    bool manualPoll() const { return m_manualPoll; }
+
     // Your app provides a function that routes callbacks to LobbyServer/GameHost/LobbyClient/GameClient.
     void setConnStatusRouter(ConnStatusRouterFn fn) { m_router = fn; }
 
@@ -33,4 +41,5 @@ private:
 private:
     ISteamNetworkingSockets* m_iface{ nullptr };
     ConnStatusRouterFn m_router{ nullptr };
+    bool m_manualPoll{ false };
 };
\ No newline at end of file
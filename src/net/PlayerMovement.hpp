@@ -0,0 +1,22 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+
+#include "GameProtocol.hpp"
+
+namespace game {
+
+    static constexpr float kMoveSpeed = 240.f; // px per second along each held axis
+
+    // One sim tick of a player's movement. GameHost runs it authoritatively and GameClient runs
+    // the very same steps to predict its own player, so both must only ever go through here.
+    inline void stepPlayer(PlayerState& p, int8_t moveX, int8_t moveY, float dt) {
+        p.x += (float)moveX * kMoveSpeed * dt;
+        p.y += (float)moveY * kMoveSpeed * dt;
+
+        // simple bounds for now (matches 1280x720 window)
+        p.x = std::clamp(p.x, 0.f, kWorldWidth);
+        p.y = std::clamp(p.y, 0.f, kWorldHeight);
+    }
+
+} // namespace game
\ No newline at end of file
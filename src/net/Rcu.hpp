@@ -0,0 +1,86 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+// Quiescent-state RCU for a fixed set of reader threads (the lobby workers).
+// Readers take no locks: a pointer loaded from an RcuPtr stays valid until that reader's next
+// quiescent()/offline(). Writers swap pointers and never wait; replaced objects are freed once
+// every reader has passed a quiescent state since the swap.
+class RcuDomain {
+public:
+    void init(uint32_t readers) {
+        m_readers = readers;
+        m_seen.reset(new Slot[readers]);
+        for (uint32_t i = 0; i < readers; ++i) m_seen[i].epoch.store(m_epoch.load());
+    }
+
+    // Reader i: no pointers from before this call are still in use
+    void quiescent(uint32_t i) { m_seen[i].epoch.store(m_epoch.load()); }
+    // Reader i is about to block and holds nothing until online()
+    void offline(uint32_t i) { m_seen[i].epoch.store(kOffline); }
+    void online(uint32_t i) { quiescent(i); }
+
+    // Writer: stamp for something just unpublished
+    uint64_t retire() { return m_epoch.fetch_add(1) + 1; }
+
+    bool safeToFree(uint64_t retiredAt) const {
+        for (uint32_t i = 0; i < m_readers; ++i) {
+            if (m_seen[i].epoch.load() < retiredAt) return false;
+        }
+        return true;
+    }
+
+private:
+    static constexpr uint64_t kOffline = ~0ull;
+
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch{ 0 };
+    };
+
+    std::atomic<uint64_t> m_epoch{ 1 };
+    uint32_t m_readers{ 0 };
+    std::unique_ptr<Slot[]> m_seen;
+};
+
+// Single-writer pointer to an immutable T, read lock-free through an RcuDomain.
+template <class T>
+class RcuPtr {
+public:
+    RcuPtr() = default;
+    RcuPtr(const RcuPtr&) = delete;
+    RcuPtr& operator=(const RcuPtr&) = delete;
+
+    ~RcuPtr() {
+        // Only once no reader can be running
+        delete m_cur.load();
+        for (auto& r : m_retired) delete r.obj;
+    }
+
+    const T* load() const { return m_cur.load(std::memory_order_acquire); }
+
+    void publish(std::unique_ptr<T> next, RcuDomain& domain) {
+        T* old = m_cur.exchange(next.release());
+        if (old) m_retired.push_back(Retired{ domain.retire(), old });
+        reclaim(domain);
+    }
+
+    void reclaim(RcuDomain& domain) {
+        size_t kept = 0;
+        for (auto& r : m_retired) {
+            if (domain.safeToFree(r.at)) delete r.obj;
+            else m_retired[kept++] = r;
+        }
+        m_retired.resize(kept);
+    }
+
+private:
+    struct Retired {
+        uint64_t at;
+        T* obj;
+    };
+
+    std::atomic<T*> m_cur{ nullptr };
+    std::vector<Retired> m_retired; // writer only
+};
\ No newline at end of file
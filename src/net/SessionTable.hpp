@@ -0,0 +1,126 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+
+#include <steam/steamnetworkingtypes.h>
+
+#include "LobbyProtocol.hpp"
+#include "FlatMap.hpp"
+
+// What a lobby shard keeps per session, split by how often it's touched. LobbySession is read or
+// written on every heartbeat, expiry and index update; LobbySessionInfo only when the session
+// (re)announces or its list entry is rebuilt.
+struct LobbySession {
+    using Clock = std::chrono::steady_clock;
+    static constexpr uint32_t kNoListSlot = 0xFFFFFFFFu;
+
+    uint64_t sessionKey{};
+
+    Clock::time_point lastSeen{};
+    Clock::time_point migratingSince{};
+
+    // deadline of this session's live entry in the shard's TTL heap ({} = none queued)
+    Clock::time_point expiryAt{};
+
+    // m_migratingBySince key the session is filed under ({} = not Migrating)
+    Clock::time_point indexedSince{};
+
+    // current lobby connection that "owns" the session (host's lobby conn)
+    HSteamNetConnection ownerConn{ k_HSteamNetConnection_Invalid };
+
+    // index into the shard's list entries (kNoListSlot = not listed yet)
+    uint32_t listSlot{ kNoListSlot };
+
+    lobby::SessionState state{ lobby::SessionState::Open };
+    uint8_t curPlayers{ 1 };
+    uint8_t maxPlayers{ 3 };
+
+    // slots held for QuickMatch joiners (count down as reservations lapse)
+    uint8_t reservedSlots{ 0 };
+
+    // free-slot bucket the session is filed under (0 = not Open)
+    uint8_t openBucket{ 0 };
+
+    // where the announce came from: 0 = a host on this lobby, else the LobbyPeers link index + 1
+    uint8_t origin{ 0 };
+};
+
+struct LobbySessionInfo {
+    uint32_t ipv4_host_order{};
+    uint16_t gamePort{};
+    uint32_t worldSeed{};
+    char     name[32]{};
+    uint8_t  addrFamily{ lobby::AddrIPv4 };
+    uint8_t  ipv6[16]{}; // AddrIPv6 only
+};
+
+// Sessions in two dense parallel arrays found through a FlatMap from key to slot, so a lookup is
+// one probe run plus one hot record, and sessions coming and going allocate nothing once the
+// arrays have grown. Erase moves the last session into the hole: pointers and references are
+// valid until the next insert or erase.
+class SessionTable {
+public:
+    LobbySession* find(uint64_t key) {
+        const uint32_t* slot = m_index.find(key);
+        return slot ? &m_hot[*slot] : nullptr;
+    }
+    const LobbySession* find(uint64_t key) const {
+        const uint32_t* slot = m_index.find(key);
+        return slot ? &m_hot[*slot] : nullptr;
+    }
+    bool contains(uint64_t key) const { return m_index.find(key) != nullptr; }
+
+    // Existing session for key, or a new default one (sessionKey set)
+    LobbySession& insert(uint64_t key) {
+        bool inserted;
+        uint32_t& slot = m_index.insert(key, inserted);
+        if (inserted) {
+            slot = (uint32_t)m_hot.size();
+            m_hot.emplace_back();
+            m_hot.back().sessionKey = key;
+            m_cold.emplace_back();
+        }
+        return m_hot[slot];
+    }
+
+    LobbySessionInfo& info(const LobbySession& s) { return m_cold[(size_t)(&s - m_hot.data())]; }
+    const LobbySessionInfo& info(const LobbySession& s) const { return m_cold[(size_t)(&s - m_hot.data())]; }
+
+    void erase(uint64_t key) {
+        const uint32_t* found = m_index.find(key);
+        if (!found) return;
+
+        const uint32_t slot = *found;
+        const uint32_t last = (uint32_t)m_hot.size() - 1;
+        if (slot != last) {
+            m_hot[slot] = m_hot[last];
+            m_cold[slot] = m_cold[last];
+            *m_index.find(m_hot[slot].sessionKey) = slot;
+        }
+        m_hot.pop_back();
+        m_cold.pop_back();
+        m_index.erase(key);
+    }
+
+    void clear() {
+        m_index.clear();
+        m_hot.clear();
+        m_cold.clear();
+    }
+
+    size_t size() const { return m_hot.size(); }
+    size_t bytes() const { return m_index.bytes() + m_hot.capacity() * sizeof(LobbySession) + m_cold.capacity() * sizeof(LobbySessionInfo); }
+
+    // Dense, in no particular order
+    std::vector<LobbySession>::iterator begin() { return m_hot.begin(); }
+    std::vector<LobbySession>::iterator end() { return m_hot.end(); }
+    std::vector<LobbySession>::const_iterator begin() const { return m_hot.begin(); }
+    std::vector<LobbySession>::const_iterator end() const { return m_hot.end(); }
+
+private:
+    FlatMap<uint64_t, uint32_t> m_index; // sessionKey -> slot in m_hot/m_cold
+    std::vector<LobbySession> m_hot;
+    std::vector<LobbySessionInfo> m_cold;
+};
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+#include <atomic>
+#include <vector>
+#include <cstdint>
+
+#include <steam/steamnetworkingsockets.h>
+#include <steam/isteamnetworkingsockets.h>
+#include <steam/steamnetworkingtypes.h>
+#include <steam/isteamnetworkingutils.h>
+
+// Immutable, refcounted byte block that can back any number of outgoing GNS messages
+// without copying. Each message holds a reference until GNS frees it (possibly on its
+// service thread), so the owner can drop/replace its own reference at any time.
+class SharedPayload {
+public:
+    static SharedPayload* create(std::vector<uint8_t>&& bytes) { return new SharedPayload(std::move(bytes)); }
+
+    void addRef() { m_refs.fetch_add(1, std::memory_order_relaxed); }
+    void release() {
+        if (m_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this;
+    }
+
+    const uint8_t* data() const { return m_bytes.data(); }
+    uint32_t size() const { return (uint32_t)m_bytes.size(); }
+
+    // Message pointing at our bytes; pass to ISteamNetworkingSockets::SendMessages.
+    SteamNetworkingMessage_t* makeMessage(HSteamNetConnection to, int sendFlags) {
+        SteamNetworkingMessage_t* msg = SteamNetworkingUtils()->AllocateMessage(0);
+        msg->m_conn = to;
+        msg->m_nFlags = sendFlags;
+        msg->m_pData = const_cast<uint8_t*>(m_bytes.data());
+        msg->m_cbSize = (int)m_bytes.size();
+        msg->m_nUserData = (int64)(intptr_t)this;
+        msg->m_pfnFreeData = &SharedPayload::s_freeData;
+        addRef();
+        return msg;
+    }
+
+private:
+    explicit SharedPayload(std::vector<uint8_t>&& bytes) : m_bytes(std::move(bytes)) {}
+    ~SharedPayload() = default;
+
+    static void s_freeData(SteamNetworkingMessage_t* msg) {
+        reinterpret_cast<SharedPayload*>((intptr_t)msg->m_nUserData)->release();
+    }
+
+    std::atomic<int> m_refs{ 1 };
+    std::vector<uint8_t> m_bytes;
+};
\ No newline at end of file
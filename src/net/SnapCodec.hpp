@@ -0,0 +1,132 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+
+#include "GameProtocol.hpp"
+#include "BitStream.hpp"
+
+namespace game {
+
+    // Player positions as they go on the wire: fixed point, `posScale` steps per pixel
+    struct QuantSnap {
+        uint32_t tick{ 0 };
+        uint32_t seq{ 0 };  // snapshot number (SnapDeltaHdr::seq)
+        uint32_t x[kMaxPlayers]{};
+        uint32_t y[kMaxPlayers]{};
+    };
+
+    // Snapshot body shared by GameHost (encode) and GameClient (decode). Coordinates take just the
+    // bits the world bounds need at this precision. Against a baseline, each player is one bit
+    // when it didn't move, and a moved axis is a short signed step unless it jumped far.
+    class SnapCodec {
+    public:
+        static constexpr uint16_t kDefaultPosScale = 8; // 1/8 px
+        static constexpr int kStepBits = 10;            // signed step vs the baseline, +-511 steps
+
+        explicit SnapCodec(uint16_t posScale = kDefaultPosScale)
+            : m_scale(std::clamp<uint16_t>(posScale, 1, 64)),
+              m_xMax((uint32_t)(kWorldWidth * m_scale)),
+              m_yMax((uint32_t)(kWorldHeight * m_scale)),
+              m_xBits(bitsFor(m_xMax)),
+              m_yBits(bitsFor(m_yMax)) {}
+
+        uint16_t posScale() const { return m_scale; }
+
+        void quantize(const PlayerState* states, uint32_t tick, QuantSnap& out) const {
+            out.tick = tick;
+            for (uint8_t i = 0; i < kMaxPlayers; ++i) {
+                out.x[i] = quantize(states[i].x, m_xMax);
+                out.y[i] = quantize(states[i].y, m_yMax);
+            }
+        }
+
+        void dequantize(const QuantSnap& q, Snap& out) const {
+            out.type = Type::Snap;
+            out.serverTick = q.tick;
+            out.count = kMaxPlayers;
+            for (uint8_t i = 0; i < kMaxPlayers; ++i) {
+                out.players[i].id = i;
+                out.players[i].x = (float)q.x[i] / (float)m_scale;
+                out.players[i].y = (float)q.y[i] / (float)m_scale;
+            }
+        }
+
+        // Appends the body; base = nullptr for a full snapshot
+        void encode(std::vector<uint8_t>& out, const QuantSnap& cur, const QuantSnap* base) const {
+            BitWriter w(out);
+            for (uint8_t i = 0; i < kMaxPlayers; ++i) {
+                if (!base) {
+                    w.write(cur.x[i], m_xBits);
+                    w.write(cur.y[i], m_yBits);
+                    continue;
+                }
+
+                const bool moved = cur.x[i] != base->x[i] || cur.y[i] != base->y[i];
+                w.writeBit(moved);
+                if (!moved) continue;
+                encodeAxis(w, cur.x[i], base->x[i], m_xBits);
+                encodeAxis(w, cur.y[i], base->y[i], m_yBits);
+            }
+        }
+
+        bool decode(const uint8_t* data, size_t size, const QuantSnap* base, QuantSnap& out) const {
+            BitReader r(data, size);
+            for (uint8_t i = 0; i < kMaxPlayers; ++i) {
+                if (!base) {
+                    out.x[i] = r.read(m_xBits);
+                    out.y[i] = r.read(m_yBits);
+                }
+                else if (!r.readBit()) {
+                    out.x[i] = base->x[i];
+                    out.y[i] = base->y[i];
+                }
+                else {
+                    out.x[i] = decodeAxis(r, base->x[i], m_xBits);
+                    out.y[i] = decodeAxis(r, base->y[i], m_yBits);
+                }
+                if (out.x[i] > m_xMax || out.y[i] > m_yMax) return false;
+            }
+            return r.ok();
+        }
+
+    private:
+        static int bitsFor(uint32_t maxValue) {
+            int bits = 1;
+            while (bits < 32 && (maxValue >> bits) != 0) ++bits;
+            return bits;
+        }
+
+        uint32_t quantize(float v, uint32_t max) const {
+            const float q = std::round(v * (float)m_scale);
+            return (q <= 0.f) ? 0u : std::min<uint32_t>((uint32_t)q, max);
+        }
+
+        static void encodeAxis(BitWriter& w, uint32_t cur, uint32_t base, int fullBits) {
+            const int32_t step = (int32_t)cur - (int32_t)base;
+            w.writeBit(step != 0);
+            if (step == 0) return;
+
+            const bool small = step >= -(1 << (kStepBits - 1)) && step < (1 << (kStepBits - 1));
+            w.writeBit(!small);
+            if (small) w.writeSigned(step, kStepBits);
+            else w.write(cur, fullBits);
+        }
+
+        static uint32_t decodeAxis(BitReader& r, uint32_t base, int fullBits) {
+            if (!r.readBit()) return base;
+            if (r.readBit()) return r.read(fullBits);
+            return (uint32_t)((int32_t)base + r.readSigned(kStepBits));
+        }
+
+    private:
+        uint16_t m_scale;
+        uint32_t m_xMax;
+        uint32_t m_yMax;
+        int m_xBits;
+        int m_yBits;
+    };
+
+} // namespace game
\ No newline at end of file